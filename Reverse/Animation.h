@@ -0,0 +1,187 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+#include "SlotMap.h"
+
+using AnimationHandle = SlotHandle;
+
+struct AnimationStats {
+	std::size_t started{ 0 };
+	std::size_t finished{ 0 };
+	std::size_t cancelled{ 0 };
+	std::size_t steps{ 0 };
+	std::size_t active{ 0 };
+};
+
+// Drives time-based transitions. Running animations sit in a timer wheel of
+// tick-sized slots, so an advance only looks at the slots that came due.
+// Nothing runs, and the platform timer can be stopped, once every animation
+// has finished: Advance then returns nothing, and WhenActive is called again
+// when the next animation starts. The clock can be replaced.
+class Animator {
+public:
+	using Clock = std::chrono::steady_clock;
+	using Duration = Clock::duration;
+	using TimePoint = Clock::time_point;
+	// Receives the eased progress from 0 to 1; the last call gets exactly 1.
+	using Step = std::function<void(float)>;
+
+private:
+	static constexpr std::size_t slotCount = 64;
+
+	struct Animation {
+		TimePoint start;
+		Duration duration;
+		std::uint64_t interval;
+		Step step;
+	};
+	struct Due {
+		AnimationHandle handle;
+		std::uint64_t tick;
+	};
+
+	std::function<TimePoint()> _now{ Clock::now };
+	Duration _tick{ std::chrono::milliseconds{ 16 } };
+	TimePoint _origin{ Clock::now() };
+	std::uint64_t _lastTick{ 0 };
+	SlotMap<Animation> _animations;
+	std::array<std::vector<Due>, slotCount> _wheel;
+	std::vector<Due> _running;
+	bool _advancing{ false };
+	std::function<void(Duration)> _activeEvent{ [](Duration) {} };
+	AnimationStats _stats;
+
+	Animator() {}
+
+	std::uint64_t TickAt(TimePoint time) const {
+		return time <= _origin ? 0 : static_cast<std::uint64_t>((time - _origin) / _tick);
+	}
+
+	void Schedule(AnimationHandle handle, std::uint64_t tick) {
+		_wheel[tick % slotCount].push_back({ handle, tick });
+	}
+
+	// Smoothstep: eases in and out without overshooting.
+	static float Ease(float t) {
+		return t * t * (3.f - 2.f * t);
+	}
+
+public:
+	static Animator& GetInstance() {
+		static Animator instance;
+		return instance;
+	}
+
+	void SetClock(std::function<TimePoint()>&& now) {
+		_now = std::move(now);
+		_origin = _now();
+		_lastTick = 0;
+	}
+
+	// Called with the tick length whenever animations start after all had
+	// settled, so the platform can start its timer.
+	void WhenActive(std::function<void(Duration)>&& f) {
+		_activeEvent = std::move(f);
+	}
+
+	Duration Tick() const {
+		return _tick;
+	}
+
+	// Steps every interval ticks until duration has passed. The first step
+	// runs on the next tick.
+	AnimationHandle Start(Duration duration, Step&& step, std::uint64_t interval = 1) {
+		bool idle = _animations.Empty() && !_advancing;
+		TimePoint now = _now();
+		if (idle) {
+			// Restart tick counting so an idle stretch is not walked slot by
+			// slot. Whatever is left in the wheel belongs to cancelled animations.
+			_origin = now;
+			_lastTick = 0;
+			for (auto& slot : _wheel) {
+				slot.clear();
+			}
+		}
+		interval = interval ? interval : 1;
+		auto handle = _animations.Insert({ now, duration, interval, std::move(step) });
+		Schedule(handle, TickAt(now) + interval);
+		++_stats.started;
+		if (idle) {
+			_activeEvent(_tick);
+		}
+		return handle;
+	}
+
+	// The animation's last step is not run. Unknown handles are ignored.
+	void Cancel(AnimationHandle handle) {
+		if (_animations.Erase(handle)) {
+			++_stats.cancelled;
+		}
+	}
+
+	bool Active() const {
+		return !_animations.Empty();
+	}
+
+	// Steps every animation that came due. Returns the tick length while any
+	// remain, or nothing once all have settled.
+	std::optional<Duration> Advance() {
+		TimePoint now = _now();
+		std::uint64_t current = TickAt(now);
+		// A long stall only needs each slot visited once.
+		std::uint64_t first = current - (std::min)(current - (std::min)(_lastTick, current), std::uint64_t{ slotCount }) + 1;
+		for (std::uint64_t tick = first; tick <= current; ++tick) {
+			auto& slot = _wheel[tick % slotCount];
+			for (std::size_t i = 0; i < slot.size();) {
+				if (slot[i].tick > current) {
+					++i;
+					continue;
+				}
+				_running.push_back(slot[i]);
+				slot[i] = slot.back();
+				slot.pop_back();
+			}
+		}
+		_lastTick = (std::max)(_lastTick, current);
+		// Steps may start or cancel animations, so they run after the wheel
+		// has been walked.
+		_advancing = true;
+		for (auto const& due : _running) {
+			auto animation = _animations.Get(due.handle);
+			if (!animation) {
+				continue;
+			}
+			float t = animation->duration.count() > 0
+				? std::chrono::duration<float>(now - animation->start) / std::chrono::duration<float>(animation->duration)
+				: 1.f;
+			bool done = t >= 1.f;
+			Step step = done ? std::move(animation->step) : animation->step;
+			if (!done) {
+				Schedule(due.handle, current + animation->interval);
+			} else {
+				_animations.Erase(due.handle);
+				++_stats.finished;
+			}
+			++_stats.steps;
+			step(done ? 1.f : Ease(t));
+		}
+		_running.clear();
+		_advancing = false;
+		if (!Active()) {
+			return std::nullopt;
+		}
+		return _tick;
+	}
+
+	AnimationStats Stats() const {
+		AnimationStats stats = _stats;
+		stats.active = _animations.Size();
+		return stats;
+	}
+};
@@ -0,0 +1,80 @@
+#pragma once
+#include "Controls.h"
+#include "Input.h"
+#include "InputBatcher.h"
+#include "Layout.h"
+#include "UserInterface.h"
+
+// The application without a platform: builds the UI, lays it out for the
+// client size and turns input events into control calls. A window, or a
+// headless driver, feeds it and paints what it invalidates.
+class Application {
+private:
+	LayoutNode _layout;
+	UserInterfaceHandles _ui;
+	Size _size{};
+	InputBatcher _batcher;
+
+public:
+	Application() : _ui{ UserInterface(_layout) } {}
+	~Application() {
+		auto& controls = ControlContainer::GetInstance();
+		for (auto handle : { _ui.input, _ui.output, _ui.numbers }) {
+			controls.Remove(handle);
+		}
+	}
+
+	Application(Application const&) = delete;
+	Application& operator=(Application const&) = delete;
+
+	void Resize(Size size) {
+		_size = size;
+		_layout.Layout({ 0.f, 0.f, size.width, size.height });
+	}
+
+	Size ClientSize() const {
+		return _size;
+	}
+
+	UserInterfaceHandles const& Handles() const {
+		return _ui;
+	}
+
+	InputBatcher& Batcher() {
+		return _batcher;
+	}
+
+	// Pointer moves wait for the next Pump(), so a frame hit-tests only the
+	// latest position. Anything else is dispatched at once, after the moves
+	// that came before it.
+	void Post(InputEvent const& event) {
+		_batcher.Push(event);
+		if (event.kind != InputEvent::Kind::PointerMove) {
+			Pump();
+		}
+	}
+
+	// Call before each frame.
+	void Pump() {
+		_batcher.Drain([this](InputEvent const& event) { Dispatch(event); });
+	}
+
+	// Keystrokes are timed from their timestamp; see InputLatency.
+	void Dispatch(InputEvent const& event) {
+		auto start = std::chrono::steady_clock::now();
+		auto& controls = ControlContainer::GetInstance();
+		auto invalidations = controls.Invalidations();
+		switch (event.kind) {
+		case InputEvent::Kind::PointerMove: controls.OnHover(event.point); break;
+		case InputEvent::Kind::PointerDown: controls.OnClick(event.point); break;
+		case InputEvent::Kind::PointerUp: controls.LeaveClick(); break;
+		case InputEvent::Kind::Wheel: controls.OnWheel(event.point, event.delta); break;
+		case InputEvent::Kind::Char: controls.OnChar(event.ch); break;
+		case InputEvent::Kind::Key: controls.OnKeyDown(event.key); break;
+		case InputEvent::Kind::Resize: Resize(event.size); break;
+		}
+		if (event.kind == InputEvent::Kind::Char || event.kind == InputEvent::Kind::Key) {
+			InputLatency::GetInstance().Handled(event.time, start, controls.Invalidations() != invalidations);
+		}
+	}
+};
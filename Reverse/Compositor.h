@@ -0,0 +1,282 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DisplayList.h"
+#include "Renderer.h"
+
+struct CompositorStats {
+	std::size_t primitives{ 0 };
+	std::size_t batches{ 0 };
+	// Draw and clip calls made on the backend by the last Flush.
+	std::size_t backendCalls{ 0 };
+};
+
+// Collects a frame's primitives from every control, then submits them to the
+// backend grouped by primitive type, brush and clip. A primitive may only be
+// moved earlier, into an existing batch, when it overlaps nothing drawn in
+// between, so the composed frame looks exactly as if it had been drawn in
+// order. Layers are passed through to the backend; nothing is moved into or
+// out of one.
+class Compositor final : public Renderer {
+private:
+	enum class Kind : std::uint8_t { Clear, Fill, Solid, Stroke, Text, Layer, BeginLayer, EndLayer };
+
+	struct Primitive {
+		Rect rect;
+		std::size_t textOffset{ 0 };
+		std::size_t textLength{ 0 };
+		TextKey key{};
+		// Replayed instead of a layer the backend no longer holds.
+		DisplayList const* fallback{ nullptr };
+	};
+
+	struct Batch {
+		Kind kind;
+		Brush brush;
+		Color color;
+		Rect clip;
+		// Union of what the batch's primitives may touch.
+		Rect bounds;
+		std::vector<Primitive> primitives;
+	};
+
+	// How far back a primitive looks for a batch to join.
+	static constexpr std::size_t searchWindow = 32;
+
+	std::vector<Batch> _batches;
+	std::size_t _used{ 0 };
+	std::vector<Rect> _clips{ unboundedRectangle };
+	std::wstring _text;
+	std::vector<Rect> _rects;
+	std::vector<TextRun> _runs;
+	CompositorStats _stats;
+	float _maxAdvance;
+	Renderer const* _backend{ nullptr };
+	// The layer being recorded, then the one last recorded: the backend
+	// only holds it once the frame is flushed.
+	LayerKey _layer;
+
+	// Centred text is not clipped to its box. Text that fits stays inside
+	// it; wider text may spill sideways and, once it wraps, vertically.
+	Rect TextBounds(Rect rect, std::size_t length) const {
+		float width = static_cast<float>(length) * _maxAdvance;
+		if (_maxAdvance <= 0.f) {
+			return unboundedRectangle;
+		}
+		if (width <= rect.Width()) {
+			return rect;
+		}
+		float spill = (width - rect.Width()) / 2.f;
+		return { rect.left - spill, unboundedRectangle.top, rect.right + spill, unboundedRectangle.bottom };
+	}
+
+	static bool Overlaps(Rect a, Rect b) {
+		return !RectangleIsEmpty(IntersectRectangle(a, b));
+	}
+
+	static bool Batches(Kind kind) {
+		return kind == Kind::Fill || kind == Kind::Solid || kind == Kind::Stroke || kind == Kind::Text;
+	}
+
+	void Add(Kind kind, Brush brush, Color color, Rect bounds, Primitive primitive) {
+		Rect clip = _clips.back();
+		bounds = IntersectRectangle(bounds, clip);
+		if (RectangleIsEmpty(bounds)) {
+			return;
+		}
+		++_stats.primitives;
+		std::size_t stop = _used > searchWindow ? _used - searchWindow : 0;
+		for (std::size_t i = _used; i > stop; --i) {
+			Batch& batch = _batches[i - 1];
+			if (batch.kind == kind && batch.brush == brush && batch.color == color && batch.clip == clip && Batches(kind)) {
+				batch.bounds = UnionRectangle(batch.bounds, bounds);
+				batch.primitives.emplace_back(primitive);
+				return;
+			}
+			if (Overlaps(batch.bounds, bounds)) {
+				break;
+			}
+		}
+		Append(kind, brush, color, clip, bounds, primitive);
+	}
+
+	void Append(Kind kind, Brush brush, Color color, Rect clip, Rect bounds, Primitive primitive) {
+		// Batches are recycled between frames to keep their storage.
+		if (_used == _batches.size()) {
+			_batches.emplace_back();
+		}
+		Batch& batch = _batches[_used++];
+		batch.kind = kind;
+		batch.brush = brush;
+		batch.color = color;
+		batch.clip = clip;
+		batch.bounds = bounds;
+		batch.primitives.clear();
+		batch.primitives.emplace_back(primitive);
+	}
+
+public:
+	// maxAdvance bounds the width of one character of the backend's font;
+	// without it text is assumed to reach anywhere.
+	explicit Compositor(float maxAdvance = 0.f) : _maxAdvance{ maxAdvance } {}
+
+	// The renderer frames will be flushed to, asked which layers it holds.
+	// Without one no layers are used.
+	void SetBackend(Renderer const* backend) {
+		_backend = backend;
+	}
+
+	void Clear(Color color) override {
+		Add(Kind::Clear, Brush::TextWrite, color, unboundedRectangle, {});
+	}
+
+	void FillRectangle(Rect rect, Brush brush) override {
+		Add(Kind::Fill, brush, {}, rect, { rect });
+	}
+
+	void FillSolid(Rect rect, Color color) override {
+		Add(Kind::Solid, Brush::TextWrite, color, rect, { rect });
+	}
+
+	void DrawRectangle(Rect rect, Brush brush) override {
+		// The stroke straddles the outline.
+		Rect bounds{ rect.left - 1.f, rect.top - 1.f, rect.right + 1.f, rect.bottom + 1.f };
+		Add(Kind::Stroke, brush, {}, bounds, { rect });
+	}
+
+	void DrawText(Rect rect, std::wstring_view text, Brush brush, TextKey key) override {
+		std::size_t offset = _text.size();
+		_text.append(text);
+		Add(Kind::Text, brush, {}, TextBounds(rect, text.size()), { rect, offset, text.size(), key });
+	}
+
+	void PushClip(Rect rect) override {
+		_clips.emplace_back(IntersectRectangle(_clips.back(), rect));
+	}
+
+	void PopClip() override {
+		if (_clips.size() > 1) {
+			_clips.pop_back();
+		}
+	}
+
+	bool CanLayer(Rect area) const override {
+		return _backend && _backend->CanLayer(area);
+	}
+
+	bool HasLayer(LayerKey key) const override {
+		bool recorded = _layer.owner == key.owner && _layer.item == key.item && _layer.version == key.version;
+		return _backend && (recorded || _backend->HasLayer(key));
+	}
+
+	bool DrawLayer(LayerKey key, Rect area) override {
+		if (!HasLayer(key)) {
+			return false;
+		}
+		Add(Kind::Layer, Brush::TextWrite, {}, area, { area, 0, 0, key });
+		return true;
+	}
+
+	// HasLayer is answered while painting, but layers are only stored and
+	// drawn during Flush, where storing one may evict another drawn later in
+	// the frame. That one is then replayed from fallback, which must stay
+	// unchanged until Flush.
+	void DrawLayerOr(LayerKey key, Rect area, DisplayList const& fallback) override {
+		if (!HasLayer(key)) {
+			fallback.Replay(*this);
+			return;
+		}
+		Add(Kind::Layer, Brush::TextWrite, {}, area, { area, 0, 0, key, &fallback });
+	}
+
+	// A layer is rendered whole, whatever the clip outside it, and nothing
+	// around it is batched across its bounds.
+	void BeginLayer(LayerKey key, Rect area) override {
+		_layer = key;
+		++_stats.primitives;
+		Append(Kind::BeginLayer, Brush::TextWrite, {}, unboundedRectangle, unboundedRectangle, { area, 0, 0, key });
+		_clips.emplace_back(area);
+	}
+
+	void EndLayer() override {
+		_clips.pop_back();
+		++_stats.primitives;
+		Append(Kind::EndLayer, Brush::TextWrite, {}, unboundedRectangle, unboundedRectangle, {});
+	}
+
+	// Submits the collected frame to backend and starts a new one.
+	void Flush(Renderer& backend) {
+		_stats.batches = _used;
+		_stats.backendCalls = 0;
+		for (std::size_t i = 0; i < _used; ++i) {
+			Batch const& batch = _batches[i];
+			bool clipped = !(batch.clip == unboundedRectangle);
+			if (clipped) {
+				backend.PushClip(batch.clip);
+				++_stats.backendCalls;
+			}
+			switch (batch.kind) {
+			case Kind::Clear:
+				backend.Clear(batch.color);
+				break;
+			case Kind::Fill:
+			case Kind::Stroke:
+				_rects.clear();
+				for (auto const& primitive : batch.primitives) {
+					_rects.emplace_back(primitive.rect);
+				}
+				if (batch.kind == Kind::Fill) {
+					backend.FillRectangles(_rects, batch.brush);
+				} else {
+					backend.DrawRectangles(_rects, batch.brush);
+				}
+				break;
+			case Kind::Solid:
+				for (auto const& primitive : batch.primitives) {
+					backend.FillSolid(primitive.rect, batch.color);
+				}
+				break;
+			case Kind::Text:
+				_runs.clear();
+				for (auto const& primitive : batch.primitives) {
+					_runs.push_back({ primitive.rect, std::wstring_view{ _text }.substr(primitive.textOffset, primitive.textLength), primitive.key });
+				}
+				backend.DrawTexts(_runs, batch.brush);
+				break;
+			case Kind::Layer:
+				for (auto const& primitive : batch.primitives) {
+					if (!backend.DrawLayer(primitive.key, primitive.rect) && primitive.fallback) {
+						primitive.fallback->Replay(backend);
+					}
+				}
+				break;
+			case Kind::BeginLayer:
+				backend.BeginLayer(batch.primitives.front().key, batch.primitives.front().rect);
+				break;
+			case Kind::EndLayer:
+				backend.EndLayer();
+				break;
+			}
+			++_stats.backendCalls;
+			if (clipped) {
+				backend.PopClip();
+				++_stats.backendCalls;
+			}
+		}
+		_used = 0;
+		_text.clear();
+		_clips.assign(1, unboundedRectangle);
+		_layer = {};
+	}
+
+	// Figures from the last Flush; primitives counts what went into it.
+	CompositorStats const& Stats() const {
+		return _stats;
+	}
+
+	void ResetStats() {
+		_stats = {};
+	}
+};
@@ -0,0 +1,1096 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+#include "SlotMap.h"
+#include "Geometry.h"
+#include "FenwickTree.h"
+#include "SpatialGrid.h"
+#include "ThreadPool.h"
+#include "Executor.h"
+#include "Animation.h"
+#include "LatencyHistogram.h"
+#include "DisplayList.h"
+#include "Renderer.h"
+
+// The control tree and everything it needs, free of any platform API so it can
+// be driven and rendered without a window.
+
+// Virtual-key code of the backspace key, as delivered by WM_KEYDOWN.
+constexpr unsigned keyBack = 0x08;
+
+using ControlHandle = SlotHandle;
+
+class Label;
+class TextBox;
+class Button;
+struct ControlList;
+
+class Control {
+	friend class ControlContainer;
+	friend struct ControlList;
+private:
+	ControlHandle _handle{};
+	bool _detached{ false };
+	Control* _parent{ nullptr };
+	Control* _previous{ nullptr };
+	Control* _next{ nullptr };
+	DisplayList _displayList;
+	bool _recorded{ false };
+	// Bumped whenever the control looks different. A control painted twice at
+	// the same version is treated as static and kept in a layer.
+	std::uint32_t _paintVersion{ 0 };
+	std::uint32_t _paintedVersion{ UINT32_MAX };
+
+	void Stale() {
+		_recorded = false;
+		++_paintVersion;
+	}
+protected:
+	// Intersection of every ancestor's area; the control is only visible inside it.
+	Rect _clip{ unboundedRectangle };
+	Rect _area;
+	bool _onHover{ false };
+	bool _onClick{ false };
+	bool _onFocus{ false };
+	std::function<void()> _clickEvent{ []() {} };
+	std::function<void()> _changeEvent{ []() {} };
+
+	// Runs the change handler; WhenChange and WhenChangeAsync time it.
+	void Changed();
+
+	// Cache key for the item-th text this control draws.
+	TextKey KeyFor(std::uint64_t item, std::uint32_t version) const {
+		return { (static_cast<std::uint64_t>(_handle.generation) << 32 | _handle.index) + 1, item, version };
+	}
+public:
+	Control(Rect area);
+	virtual ~Control();
+
+	virtual void Show();
+	// Replays the control's display list, re-recording it first if stale.
+	void Paint(Renderer& renderer);
+	// Records how the control looks in its current state.
+	virtual void Record(DisplayList& list);
+	DisplayList const& Display();
+	virtual void OnHover(Point point);
+	virtual void OnClick(Point click);
+	virtual void OnFocus();
+	virtual void OnKeyDown(unsigned key);
+	virtual void OnChar(wchar_t ch);
+	virtual void LeaveClick();
+	virtual void LeaveHover();
+	virtual void LeaveFocus();
+	// Returns false to let the wheel event bubble up to the parent.
+	virtual bool OnWheel(int delta);
+	virtual ControlList* Children();
+	void Move(float dx, float dy);
+	void SetArea(Rect area);
+	void Clip(Rect clip);
+	Rect VisibleArea() const;
+	// Schedules a repaint of the part of the window this control covers.
+	void Invalidate();
+	Control* Parent() const;
+	Control* NextSibling() const;
+	bool IsHover() const;
+	bool IsClicked() const;
+	bool IsFocused() const;
+	void WhenClick(std::function<void()>&& f);
+	void WhenChange(std::function<void()>&& f);
+	// Like WhenChange, but the work runs on the container's background
+	// executor. snapshot() reads what the work needs on the UI thread,
+	// work(snapshot, token) runs in the background and may stop early once the
+	// token is cancelled, and apply(result) runs back on the UI thread. A newer
+	// change cancels the work in flight; only the latest change is applied.
+	template<typename Snapshot, typename Work, typename Apply>
+	void WhenChangeAsync(Snapshot&& snapshot, Work&& work, Apply&& apply);
+	template<typename T>
+	void SendMessage(T* to) {
+		to->GetMessage(this);
+	}
+	template<typename T, typename U>
+	void SendMessage(T* to, U* data) {
+		to->GetMessage(this, data);
+	}
+	Rect const& Area() const;
+	ControlHandle Handle() const;
+};
+
+// Intrusive sibling list: O(1) append and unlink while keeping paint order.
+struct ControlList {
+	Control* first{ nullptr };
+	Control* last{ nullptr };
+
+	void Append(Control* control) {
+		control->_previous = last;
+		control->_next = nullptr;
+		(last ? last->_next : first) = control;
+		last = control;
+	}
+
+	void Unlink(Control* control) {
+		(control->_previous ? control->_previous->_next : first) = control->_next;
+		(control->_next ? control->_next->_previous : last) = control->_previous;
+		control->_previous = control->_next = nullptr;
+	}
+};
+
+struct PaintStats {
+	// Controls looked at, and those actually painted.
+	unsigned visited{ 0 };
+	unsigned controls{ 0 };
+	// Display lists rebuilt, and whether that was spread over threads.
+	unsigned recorded{ 0 };
+	bool parallel{ false };
+	unsigned long long pixels{ 0 };
+};
+
+class ControlContainer {
+public:
+	// Virtual walks controls in insertion order through Control's vtable.
+	// Typed walks one array per concrete control type so each loop calls a
+	// final class and can be inlined; paint order is then grouped by type.
+	enum class DispatchMode { Virtual, Typed };
+private:
+	ControlContainer() {}
+	~ControlContainer() {
+		for (auto control : _controls) {
+			delete control;
+		}
+	}
+	SlotMap<Control*> _controls;
+	ControlList _roots;
+	std::vector<ControlHandle> _focused;
+	std::vector<ControlHandle> _pendingRemoval;
+	int _dispatching{ 0 };
+
+	Rect _dirty{};
+	std::uint64_t _invalidations{ 0 };
+	PaintStats _lastPaint{};
+	std::function<void(Rect)> _invalidateEvent{ [](Rect) {} };
+
+	DispatchMode _mode{ DispatchMode::Virtual };
+	struct TypedControls {
+		std::vector<Label*> labels;
+		std::vector<TextBox*> textBoxes;
+		std::vector<Button*> buttons;
+		std::vector<Control*> others;
+	} _typed;
+	bool _typedStale{ true };
+
+	// Root controls by area, so painting a region only looks at the roots
+	// near it. Rebuilt lazily after roots are added, removed or moved.
+	SpatialGrid<Control*> _rootGrid;
+	bool _gridStale{ true };
+	bool _spatialIndex{ true };
+
+	// Painting first lists the controls to draw in z-order, then rebuilds the
+	// stale display lists among them, on the record pool when there are
+	// enough, and finally replays them one by one in list order.
+	static constexpr std::size_t parallelRecordThreshold = 32;
+	std::vector<Control*> _paintList;
+	std::vector<Control*> _stale;
+	ThreadPool* _recordPool{ nullptr };
+	Executor* _backgroundExecutor{ nullptr };
+
+	// Controls removed while a pass is walking _controls are only detached;
+	// they are erased and deleted once the outermost pass has finished, so a
+	// pass never skips or revisits a control because of a swap-erase.
+	class DispatchScope {
+	private:
+		ControlContainer& _container;
+	public:
+		DispatchScope(ControlContainer& container) : _container(container) {
+			++_container._dispatching;
+		}
+		~DispatchScope() {
+			if (--_container._dispatching == 0) {
+				_container.FlushRemovals();
+			}
+		}
+	};
+
+	Control* Live(std::size_t i) {
+		Control* control = _controls[i];
+		return control->_detached ? nullptr : control;
+	}
+
+	ControlList& Siblings(Control* control) {
+		return control->_parent ? *control->_parent->Children() : _roots;
+	}
+
+	void Erase(ControlHandle handle) {
+		Control* control = *_controls.Get(handle);
+		Siblings(control).Unlink(control);
+		_controls.Erase(handle);
+		_typedStale = true;
+		_gridStale = true;
+		delete control;
+	}
+
+	void FlushRemovals() {
+		for (auto handle : _pendingRemoval) {
+			Erase(handle);
+		}
+		_pendingRemoval.clear();
+	}
+
+	void RebuildTyped();
+	void RebuildGrid();
+
+	template<typename T, typename F>
+	static bool VisitAll(std::vector<T*> const& controls, F& f) {
+		for (std::size_t i = 0; i < controls.size(); ++i) {
+			if (!controls[i]->_detached && f(controls[i])) {
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// Calls f on every live control until it returns true. In typed mode f is
+	// instantiated once per concrete type.
+	template<typename F>
+	void Visit(F&& f);
+
+	// Tree walks used in Virtual mode. A subtree whose visible area is empty,
+	// or does not contain the pointer, is skipped as a whole.
+	void CollectTree(ControlList const& list, Rect region);
+	void CollectSubtree(Control* control, Rect region);
+	void RecordStale();
+	void HoverTree(ControlList const& list, Point point);
+	void ClickTree(ControlList const& list, Point point, std::vector<ControlHandle>& focused);
+	Control* FocusTarget();
+	Control* HitTest(ControlList const& list, Point point);
+
+	void Detach(Control* control) {
+		if (auto children = control->Children()) {
+			for (auto child = children->first; child; child = child->_next) {
+				Detach(child);
+			}
+		}
+		control->_detached = true;
+		_pendingRemoval.emplace_back(control->_handle);
+	}
+public:
+	ControlHandle Add(Control* control) {
+		_typedStale = true;
+		_gridStale = true;
+		_roots.Append(control);
+		return _controls.Insert(control);
+	}
+
+	// Destroys the control, and every control it owns, in O(1) per control.
+	// Handles to them resolve to nullptr from now on.
+	bool Remove(ControlHandle handle) {
+		Control** control = _controls.Get(handle);
+		if (!control || (*control)->_detached) {
+			return false;
+		}
+		(*control)->Invalidate();
+		// Children are queued before their parent so they are unlinked first.
+		Detach(*control);
+		if (_dispatching == 0) {
+			FlushRemovals();
+		}
+		return true;
+	}
+
+	// Moves control under parent, or back to the top level when parent is null.
+	void Reparent(Control* control, Control* parent) {
+		_gridStale = true;
+		Siblings(control).Unlink(control);
+		control->_parent = parent;
+		Siblings(control).Append(control);
+		control->Clip(parent ? parent->VisibleArea() : unboundedRectangle);
+	}
+
+	// Called by controls whose area changed.
+	void Relocated(Control* control) {
+		if (!control->_parent) {
+			_gridStale = true;
+		}
+	}
+
+	// Whether Virtual mode paints through the spatial index or walks every
+	// root; the latter is kept for comparison.
+	void SetSpatialIndex(bool enabled) {
+		_spatialIndex = enabled;
+	}
+	bool SpatialIndex() const {
+		return _spatialIndex;
+	}
+
+	// Workers that rebuild display lists while painting; none records them
+	// on the calling thread.
+	void SetRecordPool(ThreadPool* pool) {
+		_recordPool = pool;
+	}
+
+	// Runs WhenChangeAsync work; without one the work runs inline.
+	void SetBackgroundExecutor(Executor* executor) {
+		_backgroundExecutor = executor;
+	}
+
+	Executor* BackgroundExecutor() const {
+		return _backgroundExecutor;
+	}
+
+	template<typename T = Control>
+	T* Get(ControlHandle handle) {
+		Control** control = _controls.Get(handle);
+		if (!control || (*control)->_detached) {
+			return nullptr;
+		}
+		return dynamic_cast<T*>(*control);
+	}
+
+	std::size_t Size() const {
+		return _controls.Size() - _pendingRemoval.size();
+	}
+
+	DispatchMode Mode() const {
+		return _mode;
+	}
+	void SetMode(DispatchMode mode) {
+		_mode = mode;
+	}
+
+	void OnHover(Point point);
+	void OnClick(Point point);
+	void OnChar(wchar_t ch);
+	void OnKeyDown(unsigned key);
+	void OnWheel(Point point, int delta);
+	void LeaveClick();
+	// Paints the controls that intersect region; everything else is skipped.
+	void Paint(Renderer& renderer, Rect region);
+
+	// Called with every invalidated area, so the platform can schedule a paint.
+	void WhenInvalidate(std::function<void(Rect)>&& f) {
+		_invalidateEvent = std::forward<std::function<void(Rect)>>(f);
+	}
+
+	// Adds area to this frame's dirty region.
+	void Invalidate(Rect area) {
+		if (RectangleIsEmpty(area)) {
+			return;
+		}
+		_dirty = UnionRectangle(_dirty, area);
+		++_invalidations;
+		_invalidateEvent(area);
+	}
+
+	// How many areas have been invalidated so far; it changes when something
+	// needs painting.
+	std::uint64_t Invalidations() const {
+		return _invalidations;
+	}
+
+	// Returns the union of everything invalidated since the last call.
+	Rect TakeDirty() {
+		auto dirty = _dirty;
+		_dirty = {};
+		return dirty;
+	}
+
+	PaintStats const& LastPaint() const {
+		return _lastPaint;
+	}
+
+	static ControlContainer& GetInstance() {
+		static ControlContainer instance;
+		return instance;
+	}
+};
+
+inline Control::Control(Rect area)
+	: _area(area) {
+	_handle = ControlContainer::GetInstance().Add(this);
+	Invalidate();
+}
+inline Control::~Control() {}
+inline void Control::Show() {}
+inline void Control::Paint(Renderer& renderer) {
+	LayerKey key = KeyFor(0, _paintVersion);
+	if (renderer.HasLayer(key)) {
+		renderer.DrawLayerOr(key, _area, Display());
+		return;
+	}
+	bool layered = _paintedVersion == _paintVersion && renderer.CanLayer(_area);
+	_paintedVersion = _paintVersion;
+	if (layered) {
+		renderer.BeginLayer(key, _area);
+		Display().Replay(renderer);
+		renderer.EndLayer();
+		renderer.DrawLayerOr(key, _area, Display());
+		return;
+	}
+	Display().Replay(renderer);
+}
+inline void Control::Record(DisplayList&) {}
+inline DisplayList const& Control::Display() {
+	if (!_recorded) {
+		_displayList.Clear();
+		Record(_displayList);
+		_recorded = true;
+	}
+	return _displayList;
+}
+inline void Control::OnHover(Point) { _onHover = true; }
+inline void Control::OnClick(Point) { _onClick = true; }
+inline void Control::OnFocus() { _onFocus = true; }
+inline void Control::OnKeyDown(unsigned) {}
+inline void Control::OnChar(wchar_t) {}
+inline void Control::LeaveClick() { _onClick = false; _clickEvent(); }
+inline void Control::LeaveHover() { _onHover = false; }
+inline void Control::LeaveFocus() { _onFocus = false; }
+inline bool Control::OnWheel(int) { return false; }
+inline ControlList* Control::Children() { return nullptr; }
+inline void Control::Move(float dx, float dy) {
+	_area = { _area.left + dx, _area.top + dy, _area.right + dx, _area.bottom + dy };
+	Stale();
+	ControlContainer::GetInstance().Relocated(this);
+	if (auto children = Children()) {
+		for (auto child = children->first; child; child = child->_next) {
+			child->Move(dx, dy);
+		}
+	}
+}
+inline void Control::SetArea(Rect area) {
+	if (RectangleContains(_area, area) && RectangleContains(area, _area)) {
+		return;
+	}
+	Invalidate();
+	_area = area;
+	Clip(_clip);
+	ControlContainer::GetInstance().Relocated(this);
+	Invalidate();
+}
+inline void Control::Clip(Rect clip) {
+	_clip = clip;
+	if (auto children = Children()) {
+		auto childClip = VisibleArea();
+		for (auto child = children->first; child; child = child->_next) {
+			child->Clip(childClip);
+		}
+	}
+}
+inline Rect Control::VisibleArea() const { return IntersectRectangle(_area, _clip); }
+inline void Control::Invalidate() {
+	Stale();
+	ControlContainer::GetInstance().Invalidate(VisibleArea());
+}
+inline Control* Control::Parent() const { return _parent; }
+inline Control* Control::NextSibling() const { return _next; }
+inline bool Control::IsHover() const { return _onHover; }
+inline bool Control::IsClicked() const { return _onClick; }
+inline bool Control::IsFocused() const { return _onFocus; }
+inline void Control::WhenClick(std::function<void()>&& f) { _clickEvent = std::forward<std::function<void()>>(f); }
+inline void Control::WhenChange(std::function<void()>&& f) {
+	_changeEvent = [f = std::move(f)]() {
+		auto start = std::chrono::steady_clock::now();
+		f();
+		InputLatency::GetInstance().Record(LatencyStage::Change, std::chrono::steady_clock::now() - start);
+	};
+}
+inline void Control::Changed() { _changeEvent(); }
+inline Rect const& Control::Area() const { return _area; }
+inline ControlHandle Control::Handle() const { return _handle; }
+
+class Label final : public Control {
+private:
+	std::wstring _text{};
+	std::uint32_t _textVersion{ 0 };
+public:
+	using Control::Control;
+
+	Label(Rect area, std::wstring text)
+		: Control(area), _text(text)
+	{}
+
+	void Record(DisplayList& list) override {
+		list.DrawText(_area, _text, KeyFor(0, _textVersion));
+	}
+
+	void Text(std::wstring text) {
+		if (_text != text) {
+			_text = text;
+			++_textVersion;
+			Invalidate();
+		}
+	}
+};
+
+class TextBox final : public Control {
+private:
+	std::wstring _text;
+	std::uint32_t _textVersion{ 0 };
+public:
+	using Control::Control;
+
+	void Record(DisplayList& list) override {
+		list.DrawRectangle(_area, Brush::TextBoxBorder);
+		list.DrawText(_area, _text, KeyFor(0, _textVersion));
+	}
+	void OnChar(wchar_t ch) override {
+		if (ch != '\b') {
+			_text += ch;
+			++_textVersion;
+			Invalidate();
+			Changed();
+		}
+	}
+	void OnKeyDown(unsigned key) override {
+		if (key == keyBack && !_text.empty()) {
+			_text.pop_back();
+			++_textVersion;
+			Invalidate();
+			Changed();
+		}
+	}
+	std::wstring Text() const {
+		return _text;
+	}
+};
+
+// Fades between its normal and hover colours instead of switching.
+class Button final : public Control {
+private:
+	static constexpr auto hoverFade = std::chrono::milliseconds{ 120 };
+
+	// 0 is the normal colour, 1 the hover colour.
+	float _hoverMix{ 0.f };
+	AnimationHandle _hoverAnimation{};
+
+	void FadeTo(float target) {
+		auto& animator = Animator::GetInstance();
+		animator.Cancel(_hoverAnimation);
+		float from = _hoverMix;
+		if (from == target) {
+			return;
+		}
+		auto duration = std::chrono::duration_cast<Animator::Duration>(hoverFade * std::abs(target - from));
+		_hoverAnimation = animator.Start(duration, [handle = Handle(), from, target](float t) {
+			if (auto button = ControlContainer::GetInstance().Get<Button>(handle)) {
+				button->_hoverMix = from + (target - from) * t;
+				button->Invalidate();
+			}
+		});
+	}
+public:
+	using Control::Control;
+	~Button() {
+		Animator::GetInstance().Cancel(_hoverAnimation);
+	}
+
+	void Record(DisplayList& list) override {
+		// Settled states keep to the palette, which batches better.
+		if (_hoverMix <= 0.f) {
+			list.FillRectangle(_area, Brush::ButtonNormal);
+		} else if (_hoverMix >= 1.f) {
+			list.FillRectangle(_area, Brush::ButtonHover);
+		} else {
+			list.FillRectangle(_area, MixColor(BrushColor(Brush::ButtonNormal), BrushColor(Brush::ButtonHover), _hoverMix));
+		}
+	}
+	void OnHover(Point point) override {
+		Control::OnHover(point);
+		FadeTo(1.f);
+	}
+	void LeaveHover() override {
+		Control::LeaveHover();
+		FadeTo(0.f);
+	}
+};
+
+// Paints a control, clipping it only when an ancestor cuts part of it off.
+template<typename T>
+void PaintClipped(Renderer& renderer, T* control) {
+	auto area = control->Area();
+	auto visible = control->VisibleArea();
+	if (RectangleContains(visible, area)) {
+		control->Paint(renderer);
+		return;
+	}
+	renderer.PushClip(visible);
+	control->Paint(renderer);
+	renderer.PopClip();
+}
+
+inline void ControlContainer::RebuildTyped() {
+	_typed.labels.clear();
+	_typed.textBoxes.clear();
+	_typed.buttons.clear();
+	_typed.others.clear();
+	for (auto control : _controls) {
+		if (control->_detached) {
+			continue;
+		}
+		if (auto label = dynamic_cast<Label*>(control)) {
+			_typed.labels.emplace_back(label);
+		} else if (auto textBox = dynamic_cast<TextBox*>(control)) {
+			_typed.textBoxes.emplace_back(textBox);
+		} else if (auto button = dynamic_cast<Button*>(control)) {
+			_typed.buttons.emplace_back(button);
+		} else {
+			_typed.others.emplace_back(control);
+		}
+	}
+	_typedStale = false;
+}
+
+template<typename F>
+void ControlContainer::Visit(F&& f) {
+	DispatchScope scope{ *this };
+	// A nested pass must not rebuild the arrays an outer pass is walking.
+	if (_mode == DispatchMode::Typed && (!_typedStale || _dispatching == 1)) {
+		if (_typedStale) {
+			RebuildTyped();
+		}
+		VisitAll(_typed.labels, f)
+			|| VisitAll(_typed.textBoxes, f)
+			|| VisitAll(_typed.buttons, f)
+			|| VisitAll(_typed.others, f);
+		return;
+	}
+	for (std::size_t i = 0; i < _controls.Size(); ++i) {
+		auto control = Live(i);
+		if (control && f(control)) {
+			return;
+		}
+	}
+}
+
+inline void ControlContainer::RebuildGrid() {
+	_rootGrid.Clear();
+	std::size_t order = 0;
+	for (auto control = _roots.first; control; control = control->_next) {
+		_rootGrid.Insert(control->VisibleArea(), control, order++);
+	}
+	_gridStale = false;
+}
+inline void ControlContainer::CollectTree(ControlList const& list, Rect region) {
+	for (auto control = list.first; control; control = control->_next) {
+		CollectSubtree(control, region);
+	}
+}
+inline void ControlContainer::CollectSubtree(Control* control, Rect region) {
+	++_lastPaint.visited;
+	if (control->_detached || RectangleIsEmpty(IntersectRectangle(control->VisibleArea(), region))) {
+		return;
+	}
+	_paintList.emplace_back(control);
+	if (auto children = control->Children()) {
+		CollectTree(*children, region);
+	}
+}
+// Each control records into its own list and reads only its own state, so
+// lists can be rebuilt side by side. Whatever is not rebuilt here is
+// recorded lazily when painted.
+inline void ControlContainer::RecordStale() {
+	_stale.clear();
+	for (auto control : _paintList) {
+		if (!control->_recorded) {
+			_stale.emplace_back(control);
+		}
+	}
+	_lastPaint.recorded = static_cast<unsigned>(_stale.size());
+	if (_recordPool && _stale.size() >= parallelRecordThreshold) {
+		_lastPaint.parallel = true;
+		_recordPool->ParallelFor(_stale.size(), [this](std::size_t i) {
+			_stale[i]->Display();
+		});
+	}
+}
+
+inline void ControlContainer::HoverTree(ControlList const& list, Point point) {
+	for (auto control = list.first; control; control = control->_next) {
+		if (control->_detached) {
+			continue;
+		}
+		bool inside = PointInRectangle(control->VisibleArea(), point);
+		if (inside) {
+			if (!control->IsHover()) {
+				control->OnHover(point);
+			}
+		} else if (control->IsHover()) {
+			control->LeaveHover();
+		} else {
+			// Descendants can only be hovered while their ancestors are.
+			continue;
+		}
+		if (auto children = control->Children()) {
+			HoverTree(*children, point);
+		}
+	}
+}
+
+inline void ControlContainer::ClickTree(ControlList const& list, Point point, std::vector<ControlHandle>& focused) {
+	for (auto control = list.first; control; control = control->_next) {
+		if (control->_detached || !PointInRectangle(control->VisibleArea(), point)) {
+			continue;
+		}
+		control->OnClick(point);
+		control->OnFocus();
+		focused.emplace_back(control->_handle);
+		if (auto children = control->Children()) {
+			ClickTree(*children, point, focused);
+		}
+	}
+}
+
+inline Control* ControlContainer::HitTest(ControlList const& list, Point point) {
+	Control* hit = nullptr;
+	for (auto control = list.first; control; control = control->_next) {
+		if (control->_detached || !PointInRectangle(control->VisibleArea(), point)) {
+			continue;
+		}
+		hit = control;
+		if (auto children = control->Children()) {
+			if (auto child = HitTest(*children, point)) {
+				hit = child;
+			}
+		}
+	}
+	return hit;
+}
+
+inline void ControlContainer::OnHover(Point point) {
+	if (_mode == DispatchMode::Virtual) {
+		DispatchScope scope{ *this };
+		HoverTree(_roots, point);
+		return;
+	}
+	Visit([=](auto control) {
+		if (PointInRectangle(control->VisibleArea(), point)) {
+			if (!control->IsHover()) {
+				control->OnHover(point);
+			}
+		} else if (control->IsHover()) {
+			control->LeaveHover();
+		}
+		return false;
+	});
+}
+
+inline void ControlContainer::OnClick(Point point) {
+	std::vector<ControlHandle> focused;
+	if (_mode == DispatchMode::Virtual) {
+		DispatchScope scope{ *this };
+		ClickTree(_roots, point, focused);
+	} else {
+		Visit([&](auto control) {
+			if (PointInRectangle(control->VisibleArea(), point)) {
+				control->OnClick(point);
+				control->OnFocus();
+				focused.emplace_back(control->Handle());
+			}
+			return false;
+		});
+	}
+	for (auto handle : _focused) {
+		auto control = Get(handle);
+		if (control && control->IsFocused()
+			&& std::find(focused.begin(), focused.end(), handle) == focused.end()) {
+			control->LeaveFocus();
+		}
+	}
+	_focused = std::move(focused);
+}
+
+// A click focuses every control under the point, containers included; keys
+// go to the deepest of them.
+inline Control* ControlContainer::FocusTarget() {
+	Control* target = nullptr;
+	int targetDepth = -1;
+	for (auto handle : _focused) {
+		auto control = Get(handle);
+		if (!control) {
+			continue;
+		}
+		int depth = 0;
+		for (auto parent = control->_parent; parent; parent = parent->_parent) {
+			++depth;
+		}
+		if (depth > targetDepth) {
+			target = control;
+			targetDepth = depth;
+		}
+	}
+	return target;
+}
+
+inline void ControlContainer::OnChar(wchar_t ch) {
+	DispatchScope scope{ *this };
+	if (auto control = FocusTarget()) {
+		control->OnChar(ch);
+	}
+}
+
+inline void ControlContainer::OnKeyDown(unsigned key) {
+	DispatchScope scope{ *this };
+	if (auto control = FocusTarget()) {
+		control->OnKeyDown(key);
+	}
+}
+
+inline void ControlContainer::OnWheel(Point point, int delta) {
+	DispatchScope scope{ *this };
+	for (auto control = HitTest(_roots, point); control; control = control->_parent) {
+		if (control->OnWheel(delta)) {
+			break;
+		}
+	}
+}
+
+inline void ControlContainer::LeaveClick() {
+	Visit([](auto control) {
+		if (control->IsClicked()) {
+			control->LeaveClick();
+		}
+		return false;
+	});
+}
+
+inline void ControlContainer::Paint(Renderer& renderer, Rect region) {
+	_lastPaint = {};
+	_lastPaint.pixels = static_cast<unsigned long long>((region.right - region.left) * (region.bottom - region.top));
+	_paintList.clear();
+	if (_mode == DispatchMode::Virtual) {
+		DispatchScope scope{ *this };
+		bool indexed = false;
+		if (_spatialIndex) {
+			if (_gridStale) {
+				RebuildGrid();
+			}
+			indexed = _rootGrid.Query(region, [&](Control* control) {
+				CollectSubtree(control, region);
+			});
+		}
+		if (!indexed) {
+			CollectTree(_roots, region);
+		}
+	} else {
+		Visit([&](auto control) {
+			++_lastPaint.visited;
+			if (!RectangleIsEmpty(IntersectRectangle(control->VisibleArea(), region))) {
+				_paintList.emplace_back(control);
+			}
+			return false;
+		});
+	}
+	RecordStale();
+	for (auto control : _paintList) {
+		PaintClipped(renderer, control);
+	}
+	_lastPaint.controls = static_cast<unsigned>(_paintList.size());
+}
+
+// Owns child controls, clips them to its area and scrolls them vertically.
+// Children keep absolute areas; scrolling moves them.
+class Panel final : public Control {
+private:
+	ControlList _children;
+	float _scroll{ 0.f };
+
+	float ContentHeight() {
+		float bottom = _area.top;
+		for (auto child = _children.first; child; child = child->NextSibling()) {
+			bottom = (std::max)(bottom, child->Area().bottom + _scroll);
+		}
+		return bottom - _area.top;
+	}
+public:
+	using Control::Control;
+
+	void Append(Control* child) {
+		ControlContainer::GetInstance().Reparent(child, this);
+	}
+
+	ControlList* Children() override {
+		return &_children;
+	}
+
+	void ScrollTo(float offset) {
+		float limit = (std::max)(0.f, ContentHeight() - (_area.bottom - _area.top));
+		offset = (std::clamp)(offset, 0.f, limit);
+		float dy = _scroll - offset;
+		_scroll = offset;
+		if (dy == 0.f) {
+			return;
+		}
+		for (auto child = _children.first; child; child = child->NextSibling()) {
+			child->Move(0.f, dy);
+		}
+		Clip(_clip);
+		Invalidate();
+	}
+
+	bool OnWheel(int delta) override {
+		ScrollTo(_scroll - static_cast<float>(delta) / 120.f * 20.f);
+		return true;
+	}
+
+	float Scroll() const {
+		return _scroll;
+	}
+};
+
+// Shows a list of any length by rendering only the rows in view. Row heights
+// are kept as prefix sums, so mapping a scroll offset to a row is O(log n),
+// and a small pool of row slots is recycled as rows scroll in and out.
+class ListView final : public Control {
+private:
+	struct Row {
+		std::size_t index{ SIZE_MAX };
+		std::wstring text;
+	};
+
+	std::function<std::wstring(std::size_t)> _source{ [](std::size_t) { return std::wstring{}; } };
+	FenwickTree<float> _heights;
+	std::vector<Row> _pool;
+	float _scroll{ 0.f };
+	float _rowHeight{ 20.f };
+	// Bumped whenever the source may return different text for a row.
+	std::uint32_t _sourceVersion{ 0 };
+
+	float Height() const {
+		return _area.bottom - _area.top;
+	}
+
+	// Row i always lives in slot i % pool size. Record grows the pool to the
+	// number of rows in view first, so no two visible rows share a slot.
+	Row& Slot(std::size_t index) {
+		Row& row = _pool[index % _pool.size()];
+		if (row.index != index) {
+			row.index = index;
+			row.text = _source(index);
+		}
+		return row;
+	}
+public:
+	using Control::Control;
+
+	void SetItems(std::size_t count, std::function<std::wstring(std::size_t)> source, float rowHeight = 20.f) {
+		_source = std::move(source);
+		_rowHeight = rowHeight;
+		_heights.Assign(count, rowHeight);
+		_pool.clear();
+		++_sourceVersion;
+		_scroll = 0.f;
+		Invalidate();
+	}
+
+	void AppendItem() {
+		_heights.PushBack(_rowHeight);
+		Invalidate();
+	}
+
+	void SetRowHeight(std::size_t index, float height) {
+		_heights.Set(index, height);
+		Invalidate();
+	}
+
+	// Drops every cached row so the next paint asks the source again.
+	void Refresh() {
+		for (auto& row : _pool) {
+			row.index = SIZE_MAX;
+		}
+		++_sourceVersion;
+		Invalidate();
+	}
+
+	void ScrollTo(float offset) {
+		offset = (std::clamp)(offset, 0.f, (std::max)(0.f, _heights.Total() - Height()));
+		if (offset != _scroll) {
+			_scroll = offset;
+			Invalidate();
+		}
+	}
+
+	void ScrollToItem(std::size_t index) {
+		ScrollTo(_heights.Prefix(index));
+	}
+
+	bool OnWheel(int delta) override {
+		ScrollTo(_scroll - static_cast<float>(delta) / 120.f * 3.f * _rowHeight);
+		return true;
+	}
+
+	void Record(DisplayList& list) override {
+		list.DrawRectangle(_area, Brush::TextBoxBorder);
+		list.PushClip(_area);
+		std::size_t index = _heights.Find(_scroll);
+		float top = _area.top + _heights.Prefix(index) - _scroll;
+		std::size_t end = index;
+		for (float bottom = top; end < _heights.Size() && bottom < _area.bottom; ++end) {
+			bottom += _heights.Get(end);
+		}
+		if (_pool.size() < end - index) {
+			_pool.assign(end - index, {});
+		}
+		for (; index < end; ++index) {
+			float bottom = top + _heights.Get(index);
+			list.DrawText({ _area.left, top, _area.right, bottom }, Slot(index).text, KeyFor(index, _sourceVersion));
+			top = bottom;
+		}
+		list.PopClip();
+	}
+
+	std::size_t Count() const {
+		return _heights.Size();
+	}
+};
+
+template<typename Snapshot, typename Work, typename Apply>
+void Control::WhenChangeAsync(Snapshot&& snapshot, Work&& work, Apply&& apply) {
+	// Touched only on the UI thread; the work itself sees just its token.
+	struct Latest {
+		std::uint64_t generation{ 0 };
+		CancellationToken token;
+	};
+	_changeEvent = [latest = std::make_shared<Latest>(), snapshot = std::forward<Snapshot>(snapshot),
+		work = std::forward<Work>(work), apply = std::forward<Apply>(apply)]() {
+		// The keystroke being handled is on screen only once a result is applied.
+		InputLatency::GetInstance().ChangeDeferred();
+		latest->token.Cancel();
+		latest->token = {};
+		auto finish = [latest, generation = ++latest->generation, apply, start = std::chrono::steady_clock::now()](auto&& result) {
+			if (latest->generation == generation) {
+				apply(std::forward<decltype(result)>(result));
+				auto& latency = InputLatency::GetInstance();
+				latency.Record(LatencyStage::Change, std::chrono::steady_clock::now() - start);
+				latency.ChangeApplied();
+			}
+		};
+		auto executor = ControlContainer::GetInstance().BackgroundExecutor();
+		if (!executor) {
+			finish(work(snapshot(), latest->token));
+			return;
+		}
+		executor->Async([work, input = snapshot(), token = latest->token]() mutable {
+			return work(std::move(input), token);
+		}, std::move(finish));
+	};
+}
+
+// Layout callback that places a control, shifting it by the scroll offset of
+// every enclosing panel since panel children keep absolute areas.
+inline std::function<void(Rect)> Arrange(ControlHandle handle) {
+	return [handle](Rect rect) {
+		auto control = ControlContainer::GetInstance().Get(handle);
+		if (!control) {
+			return;
+		}
+		float scroll = 0.f;
+		for (auto parent = control->Parent(); parent; parent = parent->Parent()) {
+			if (auto panel = dynamic_cast<Panel*>(parent)) {
+				scroll += panel->Scroll();
+			}
+		}
+		control->SetArea({ rect.left, rect.top - scroll, rect.right, rect.bottom - scroll });
+	};
+}
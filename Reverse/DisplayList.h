@@ -0,0 +1,100 @@
+#pragma once
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "Renderer.h"
+
+struct DrawCommand {
+	enum class Kind : std::uint8_t {
+		FillRectangle,
+		FillSolid,
+		DrawRectangle,
+		DrawText,
+		PushClip,
+		PopClip,
+	};
+
+	Kind kind;
+	Brush brush;
+	Rect rect;
+	// Slice of the owning list's text buffer, for DrawText.
+	std::uint32_t textOffset{ 0 };
+	std::uint32_t textLength{ 0 };
+	TextKey textKey{};
+	Color color{};
+};
+
+// A retained list of draw commands. A control records into its list when its
+// state changes; every frame after that just replays the list.
+class DisplayList {
+private:
+	std::vector<DrawCommand> _commands;
+	std::wstring _text;
+
+public:
+	void Clear() {
+		_commands.clear();
+		_text.clear();
+	}
+
+	void FillRectangle(Rect rect, Brush brush) {
+		_commands.push_back({ DrawCommand::Kind::FillRectangle, brush, rect });
+	}
+
+	void FillRectangle(Rect rect, Color color) {
+		_commands.push_back({ DrawCommand::Kind::FillSolid, Brush::TextWrite, rect, 0, 0, {}, color });
+	}
+
+	void DrawRectangle(Rect rect, Brush brush) {
+		_commands.push_back({ DrawCommand::Kind::DrawRectangle, brush, rect });
+	}
+
+	void DrawText(Rect rect, std::wstring_view text, TextKey key = {}, Brush brush = Brush::TextWrite) {
+		auto offset = static_cast<std::uint32_t>(_text.size());
+		_text.append(text);
+		_commands.push_back({ DrawCommand::Kind::DrawText, brush, rect, offset, static_cast<std::uint32_t>(text.size()), key });
+	}
+
+	void PushClip(Rect rect) {
+		_commands.push_back({ DrawCommand::Kind::PushClip, Brush::TextWrite, rect });
+	}
+
+	void PopClip() {
+		_commands.push_back({ DrawCommand::Kind::PopClip, Brush::TextWrite, {} });
+	}
+
+	std::span<DrawCommand const> Commands() const {
+		return _commands;
+	}
+
+	std::wstring_view Text(DrawCommand const& command) const {
+		return std::wstring_view{ _text }.substr(command.textOffset, command.textLength);
+	}
+
+	bool Empty() const {
+		return _commands.empty();
+	}
+
+	// Feeds every command to a Renderer, or to any sink with the same members.
+	template<typename Sink>
+	void Replay(Sink& sink) const {
+		for (auto const& command : _commands) {
+			switch (command.kind) {
+			case DrawCommand::Kind::FillRectangle: sink.FillRectangle(command.rect, command.brush); break;
+			case DrawCommand::Kind::FillSolid: sink.FillSolid(command.rect, command.color); break;
+			case DrawCommand::Kind::DrawRectangle: sink.DrawRectangle(command.rect, command.brush); break;
+			case DrawCommand::Kind::DrawText: sink.DrawText(command.rect, Text(command), command.brush, command.textKey); break;
+			case DrawCommand::Kind::PushClip: sink.PushClip(command.rect); break;
+			case DrawCommand::Kind::PopClip: sink.PopClip(); break;
+			}
+		}
+	}
+};
+
+inline void Renderer::DrawLayerOr(LayerKey key, Rect area, DisplayList const& fallback) {
+	if (!DrawLayer(key, area)) {
+		fallback.Replay(*this);
+	}
+}
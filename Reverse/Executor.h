@@ -0,0 +1,239 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// Work to be run on the UI thread, posted from any thread. Posting is a single
+// atomic exchange on an intrusive list and never blocks; only the UI thread
+// drains. WhenPosted is called, on the posting thread, when the queue goes
+// from drained to non-empty, which is where a window posts itself a message.
+class UiQueue {
+private:
+	struct Node {
+		std::atomic<Node*> next{ nullptr };
+		std::function<void()> task;
+	};
+
+	// Producers append at _head; the consumer owns _tail, a drained stub.
+	std::atomic<Node*> _head;
+	Node* _tail;
+	std::atomic<bool> _signalled{ false };
+	std::function<void()> _whenPosted{ []() {} };
+
+	UiQueue() : _head{ new Node }, _tail{ _head.load() } {}
+
+public:
+	~UiQueue() {
+		while (Node* node = _tail) {
+			_tail = node->next.load(std::memory_order_relaxed);
+			delete node;
+		}
+	}
+
+	static UiQueue& GetInstance() {
+		static UiQueue instance;
+		return instance;
+	}
+
+	// Set before any thread posts.
+	void WhenPosted(std::function<void()>&& f) {
+		_whenPosted = std::move(f);
+	}
+
+	void Post(std::function<void()> task) {
+		Node* node = new Node;
+		node->task = std::move(task);
+		Node* previous = _head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+		if (!_signalled.exchange(true)) {
+			_whenPosted();
+		}
+	}
+
+	// Runs everything posted so far on the calling thread, the UI thread.
+	// Returns how many tasks ran. A post racing with the end of a drain
+	// signals again, so nothing waits for an unrelated message.
+	std::size_t Drain() {
+		_signalled.store(false);
+		std::size_t ran = 0;
+		while (Node* next = _tail->next.load(std::memory_order_acquire)) {
+			std::function<void()> task = std::move(next->task);
+			delete _tail;
+			_tail = next;
+			task();
+			++ran;
+		}
+		return ran;
+	}
+};
+
+// Shared flag that asks background work to stop early. Copies refer to the
+// same flag; a default-constructed token starts a new one.
+class CancellationToken {
+private:
+	std::shared_ptr<std::atomic<bool>> _cancelled{ std::make_shared<std::atomic<bool>>(false) };
+
+public:
+	void Cancel() const {
+		_cancelled->store(true, std::memory_order_relaxed);
+	}
+
+	bool Cancelled() const {
+		return _cancelled->load(std::memory_order_relaxed);
+	}
+};
+
+struct ExecutorStats {
+	std::uint64_t submitted{ 0 };
+	std::uint64_t stolen{ 0 };
+};
+
+// Runs background tasks on a fixed set of threads. Each worker keeps its own
+// deque: tasks submitted from a worker go to the back of its deque and it
+// takes the newest first, while idle workers steal the oldest from the
+// front of the others'. Tasks submitted from other threads are spread round
+// robin. Pending tasks are finished before destruction returns.
+class Executor {
+private:
+	struct Queue {
+		std::mutex mutex;
+		std::deque<std::function<void()>> tasks;
+	};
+
+	std::vector<std::unique_ptr<Queue>> _queues;
+	std::vector<std::thread> _workers;
+	std::atomic<std::size_t> _queued{ 0 };
+	std::atomic<std::size_t> _nextQueue{ 0 };
+	std::atomic<std::uint64_t> _submitted{ 0 };
+	std::atomic<std::uint64_t> _stolen{ 0 };
+	std::mutex _sleepMutex;
+	std::condition_variable _wake;
+	bool _stopping{ false };
+
+	// The worker index of the current thread in this executor, if any.
+	static std::pair<Executor const*, std::size_t>& Current() {
+		thread_local std::pair<Executor const*, std::size_t> current{ nullptr, 0 };
+		return current;
+	}
+
+	bool TryTake(std::size_t self, std::function<void()>& task) {
+		{
+			Queue& own = *_queues[self];
+			std::lock_guard lock{ own.mutex };
+			if (!own.tasks.empty()) {
+				task = std::move(own.tasks.back());
+				own.tasks.pop_back();
+				_queued.fetch_sub(1, std::memory_order_acq_rel);
+				return true;
+			}
+		}
+		for (std::size_t i = 1; i < _queues.size(); ++i) {
+			Queue& victim = *_queues[(self + i) % _queues.size()];
+			std::lock_guard lock{ victim.mutex };
+			if (!victim.tasks.empty()) {
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+				_queued.fetch_sub(1, std::memory_order_acq_rel);
+				_stolen.fetch_add(1, std::memory_order_relaxed);
+				return true;
+			}
+		}
+		return false;
+	}
+
+	void Work(std::size_t self) {
+		Current() = { this, self };
+		std::function<void()> task;
+		for (;;) {
+			if (TryTake(self, task)) {
+				task();
+				task = nullptr;
+				continue;
+			}
+			std::unique_lock lock{ _sleepMutex };
+			_wake.wait(lock, [&]() { return _stopping || _queued.load(std::memory_order_acquire) > 0; });
+			if (_stopping && _queued.load(std::memory_order_acquire) == 0) {
+				return;
+			}
+		}
+	}
+
+public:
+	explicit Executor(std::size_t threads = (std::max)(std::thread::hardware_concurrency(), 2u) - 1) {
+		threads = (std::max)(threads, std::size_t{ 1 });
+		for (std::size_t i = 0; i < threads; ++i) {
+			_queues.push_back(std::make_unique<Queue>());
+		}
+		for (std::size_t i = 0; i < threads; ++i) {
+			_workers.emplace_back([this, i]() { Work(i); });
+		}
+	}
+
+	~Executor() {
+		{
+			std::lock_guard lock{ _sleepMutex };
+			_stopping = true;
+		}
+		_wake.notify_all();
+		for (auto& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	Executor(Executor const&) = delete;
+	Executor& operator=(Executor const&) = delete;
+
+	std::size_t Threads() const {
+		return _workers.size();
+	}
+
+	void Submit(std::function<void()> task) {
+		auto [owner, index] = Current();
+		if (owner != this) {
+			index = _nextQueue.fetch_add(1, std::memory_order_relaxed) % _queues.size();
+		}
+		{
+			Queue& queue = *_queues[index];
+			std::lock_guard lock{ queue.mutex };
+			queue.tasks.push_back(std::move(task));
+		}
+		_submitted.fetch_add(1, std::memory_order_relaxed);
+		_queued.fetch_add(1, std::memory_order_acq_rel);
+		// Taking the lock orders this with a worker between its check and its wait.
+		{
+			std::lock_guard lock{ _sleepMutex };
+		}
+		_wake.notify_one();
+	}
+
+	// Runs work in the background and hands its result to done on the UI
+	// thread, through UiQueue.
+	template<typename Work, typename Done>
+	void Async(Work&& work, Done&& done) {
+		Submit([work = std::forward<Work>(work), done = std::forward<Done>(done)]() mutable {
+			if constexpr (std::is_void_v<std::invoke_result_t<Work&>>) {
+				work();
+				UiQueue::GetInstance().Post(std::move(done));
+			}
+			else {
+				UiQueue::GetInstance().Post([result = work(), done = std::move(done)]() mutable {
+					done(std::move(result));
+				});
+			}
+		});
+	}
+
+	ExecutorStats Stats() const {
+		return { _submitted.load(std::memory_order_relaxed), _stolen.load(std::memory_order_relaxed) };
+	}
+};
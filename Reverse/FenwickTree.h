@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Prefix sums over a mutable sequence: O(log n) point updates, appends,
+// prefix queries and search by accumulated value.
+template<typename T>
+class FenwickTree {
+private:
+	std::vector<T> _values;
+	std::vector<T> _tree;
+
+	static std::size_t LowBit(std::size_t i) { return i & (~i + 1); }
+
+public:
+	FenwickTree() = default;
+
+	// O(n) construction from n equal values.
+	void Assign(std::size_t count, T value) {
+		_values.assign(count, value);
+		_tree.assign(count + 1, T{});
+		for (std::size_t i = 1; i <= count; ++i) {
+			_tree[i] += value;
+			std::size_t parent = i + LowBit(i);
+			if (parent <= count) {
+				_tree[parent] += _tree[i];
+			}
+		}
+	}
+
+	void PushBack(T value) {
+		if (_tree.empty()) {
+			_tree.emplace_back();
+		}
+		std::size_t i = _tree.size();
+		_values.emplace_back(value);
+		// Node i covers (i - LowBit(i), i]; everything but the new value is already summed.
+		_tree.emplace_back(value + Prefix(i - 1) - Prefix(i - LowBit(i)));
+	}
+
+	void Set(std::size_t index, T value) {
+		T delta = value - _values[index];
+		_values[index] = value;
+		for (std::size_t i = index + 1; i < _tree.size(); i += LowBit(i)) {
+			_tree[i] += delta;
+		}
+	}
+
+	T Get(std::size_t index) const {
+		return _values[index];
+	}
+
+	// Sum of the first count values.
+	T Prefix(std::size_t count) const {
+		T sum{};
+		for (std::size_t i = count; i > 0; i -= LowBit(i)) {
+			sum += _tree[i];
+		}
+		return sum;
+	}
+
+	T Total() const {
+		return Prefix(_values.size());
+	}
+
+	// Index of the value that spans accumulated position offset, i.e. the
+	// largest index with Prefix(index) <= offset. Values must be non-negative.
+	std::size_t Find(T offset) const {
+		std::size_t index = 0;
+		std::size_t step = 1;
+		while (step * 2 < _tree.size()) {
+			step *= 2;
+		}
+		for (; step > 0; step /= 2) {
+			if (index + step < _tree.size() && _tree[index + step] <= offset) {
+				index += step;
+				offset -= _tree[index];
+			}
+		}
+		return index;
+	}
+
+	std::size_t Size() const {
+		return _values.size();
+	}
+};
@@ -0,0 +1,95 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <functional>
+#include <optional>
+
+struct FrameStats {
+	std::size_t frames{ 0 };
+	std::size_t requests{ 0 };
+	// Requests that found a frame already pending and were folded into it.
+	std::size_t coalesced{ 0 };
+	std::chrono::steady_clock::duration idle{ 0 };
+};
+
+// Sits between invalidations and painting: any number of requests between
+// two frames produce one frame, frames start at most once per refresh
+// interval, and nothing is scheduled while nothing is dirty. The scheduler
+// only does the bookkeeping; the caller owns the timer. The clock can be
+// replaced so the timing can be driven by hand.
+class FrameScheduler {
+public:
+	using Clock = std::chrono::steady_clock;
+	using Duration = Clock::duration;
+	using TimePoint = Clock::time_point;
+
+private:
+	std::function<TimePoint()> _now;
+	Duration _interval;
+	TimePoint _lastFrame;
+	TimePoint _idleSince;
+	bool _pending{ false };
+	FrameStats _stats;
+
+	Duration Remaining(TimePoint now) const {
+		Duration elapsed = now - _lastFrame;
+		return elapsed >= _interval ? Duration::zero() : _interval - elapsed;
+	}
+
+public:
+	explicit FrameScheduler(Duration interval, std::function<TimePoint()>&& now = Clock::now)
+		: _now{ std::move(now) }, _interval{ interval } {
+		_idleSince = _now();
+		_lastFrame = _idleSince - interval;
+	}
+
+	void SetInterval(Duration interval) {
+		_interval = interval;
+	}
+
+	// Asks for a frame. Returns how long to wait before the next Tick when
+	// this request starts a new frame, or nothing when one is already pending
+	// and the timer is armed.
+	std::optional<Duration> Request() {
+		++_stats.requests;
+		if (_pending) {
+			++_stats.coalesced;
+			return std::nullopt;
+		}
+		TimePoint now = _now();
+		_stats.idle += now - _idleSince;
+		_pending = true;
+		return Remaining(now);
+	}
+
+	// Called when the timer fires. Returns true when a frame should be
+	// produced now; a timer firing early gets false and stays armed.
+	bool Tick() {
+		if (!_pending) {
+			return false;
+		}
+		TimePoint now = _now();
+		if (Remaining(now) > Duration::zero()) {
+			return false;
+		}
+		_pending = false;
+		_lastFrame = now;
+		_idleSince = now;
+		++_stats.frames;
+		return true;
+	}
+
+	// Whether the timer is still needed.
+	bool Pending() const {
+		return _pending;
+	}
+
+	// Idle time includes the current idle stretch.
+	FrameStats Stats() const {
+		FrameStats stats = _stats;
+		if (!_pending) {
+			stats.idle += _now() - _idleSince;
+		}
+		return stats;
+	}
+};
@@ -0,0 +1,67 @@
+#pragma once
+#include <algorithm>
+#include <limits>
+
+// Platform-neutral geometry shared by the parts of the UI that do not depend
+// on Direct2D.
+struct Point {
+	float x{ 0.f };
+	float y{ 0.f };
+};
+
+struct Size {
+	float width{ 0.f };
+	float height{ 0.f };
+
+	bool operator==(Size const&) const = default;
+};
+
+struct Rect {
+	float left{ 0.f };
+	float top{ 0.f };
+	float right{ 0.f };
+	float bottom{ 0.f };
+
+	float Width() const { return right - left; }
+	float Height() const { return bottom - top; }
+	bool operator==(Rect const&) const = default;
+};
+
+constexpr Rect unboundedRectangle{
+	std::numeric_limits<float>::lowest(), std::numeric_limits<float>::lowest(),
+	std::numeric_limits<float>::max(), std::numeric_limits<float>::max()
+};
+
+inline bool PointInRectangle(Rect rectangle, Point point) {
+	return rectangle.top < point.y
+		&& rectangle.bottom > point.y
+		&& rectangle.left < point.x
+		&& rectangle.right > point.x;
+}
+
+inline Rect IntersectRectangle(Rect a, Rect b) {
+	return { (std::max)(a.left, b.left), (std::max)(a.top, b.top),
+		(std::min)(a.right, b.right), (std::min)(a.bottom, b.bottom) };
+}
+
+inline bool RectangleIsEmpty(Rect rectangle) {
+	return rectangle.left >= rectangle.right || rectangle.top >= rectangle.bottom;
+}
+
+inline Rect UnionRectangle(Rect a, Rect b) {
+	if (RectangleIsEmpty(a)) {
+		return b;
+	}
+	if (RectangleIsEmpty(b)) {
+		return a;
+	}
+	return { (std::min)(a.left, b.left), (std::min)(a.top, b.top),
+		(std::max)(a.right, b.right), (std::max)(a.bottom, b.bottom) };
+}
+
+inline bool RectangleContains(Rect outer, Rect inner) {
+	return outer.left <= inner.left
+		&& outer.top <= inner.top
+		&& outer.right >= inner.right
+		&& outer.bottom >= inner.bottom;
+}
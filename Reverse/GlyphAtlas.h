@@ -0,0 +1,112 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+struct GlyphAtlasStats {
+	std::size_t hits{ 0 };
+	std::size_t misses{ 0 };
+	std::size_t evictions{ 0 };
+	std::size_t pages{ 0 };
+};
+
+// Rasterizes each glyph once into a page of 8-bit coverage cells and hands
+// out the cell on every later draw. With a fixed-pitch font all glyphs share
+// one cell size, so a page is a plain array of equal slots and allocation is
+// just the next free slot. When every page is full the least recently used
+// page is emptied and reused, dropping the glyphs it held.
+class GlyphAtlas {
+public:
+	// Writes a glyph's coverage into cellWidth x cellHeight bytes, row-major.
+	using Rasterizer = std::function<void(wchar_t, std::uint8_t*)>;
+
+	struct Location {
+		std::uint32_t page;
+		std::uint32_t slot;
+	};
+
+private:
+	struct Page {
+		std::vector<std::uint8_t> coverage;
+		std::vector<wchar_t> glyphs;
+		std::uint64_t lastUse{ 0 };
+	};
+
+	int _cellWidth;
+	int _cellHeight;
+	std::size_t _slotsPerPage;
+	std::size_t _maxPages;
+	Rasterizer _rasterizer;
+
+	std::vector<Page> _pages;
+	std::unordered_map<wchar_t, Location> _locations;
+	std::uint64_t _clock{ 0 };
+	GlyphAtlasStats _stats;
+
+	std::size_t CellBytes() const {
+		return static_cast<std::size_t>(_cellWidth) * static_cast<std::size_t>(_cellHeight);
+	}
+
+	std::uint32_t PageWithRoom() {
+		for (std::size_t i = 0; i < _pages.size(); ++i) {
+			if (_pages[i].glyphs.size() < _slotsPerPage) {
+				return static_cast<std::uint32_t>(i);
+			}
+		}
+		if (_pages.size() < _maxPages) {
+			_pages.emplace_back().coverage.resize(_slotsPerPage * CellBytes());
+			return static_cast<std::uint32_t>(_pages.size() - 1);
+		}
+		std::size_t victim = 0;
+		for (std::size_t i = 1; i < _pages.size(); ++i) {
+			if (_pages[i].lastUse < _pages[victim].lastUse) {
+				victim = i;
+			}
+		}
+		for (wchar_t glyph : _pages[victim].glyphs) {
+			_locations.erase(glyph);
+		}
+		_pages[victim].glyphs.clear();
+		++_stats.evictions;
+		return static_cast<std::uint32_t>(victim);
+	}
+
+public:
+	GlyphAtlas(int cellWidth, int cellHeight, Rasterizer rasterizer, std::size_t slotsPerPage = 256, std::size_t maxPages = 4)
+		: _cellWidth(cellWidth), _cellHeight(cellHeight), _slotsPerPage(slotsPerPage), _maxPages(maxPages),
+		_rasterizer(std::move(rasterizer)) {}
+
+	Location Find(wchar_t glyph) {
+		auto it = _locations.find(glyph);
+		Location location;
+		if (it != _locations.end()) {
+			++_stats.hits;
+			location = it->second;
+		} else {
+			++_stats.misses;
+			std::uint32_t page = PageWithRoom();
+			location = { page, static_cast<std::uint32_t>(_pages[page].glyphs.size()) };
+			_pages[page].glyphs.emplace_back(glyph);
+			_rasterizer(glyph, &_pages[page].coverage[location.slot * CellBytes()]);
+			_locations.emplace(glyph, location);
+		}
+		_pages[location.page].lastUse = ++_clock;
+		return location;
+	}
+
+	// Coverage of a cell, cellWidth bytes per row. Valid until the next Find.
+	std::uint8_t const* Cell(Location location) const {
+		return &_pages[location.page].coverage[location.slot * CellBytes()];
+	}
+
+	int CellWidth() const { return _cellWidth; }
+	int CellHeight() const { return _cellHeight; }
+
+	GlyphAtlasStats Stats() const {
+		GlyphAtlasStats stats = _stats;
+		stats.pages = _pages.size();
+		return stats;
+	}
+};
@@ -0,0 +1,173 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Application.h"
+#include "Executor.h"
+#include "SoftwareRenderer.h"
+
+struct DriverStats {
+	std::size_t events{ 0 };
+	std::size_t frames{ 0 };
+	std::chrono::steady_clock::duration busy{ 0 };
+	std::chrono::steady_clock::duration maxLatency{ 0 };
+};
+
+// Runs an Application without a window: events go through the application's
+// input batching and frames are painted into a software framebuffer, so the
+// whole event-to-pixels path can be timed. Each event's latency runs from its
+// timestamp to the end of the first frame after it was posted.
+class HeadlessDriver {
+private:
+	Application& _application;
+	SoftwareRenderer _renderer;
+	DriverStats _stats;
+	std::vector<std::chrono::steady_clock::time_point> _waiting;
+	std::vector<std::chrono::steady_clock::duration> _latencies;
+
+public:
+	HeadlessDriver(Application& application, int width, int height)
+		: _application{ application }, _renderer{ width, height } {
+		_application.Resize({ static_cast<float>(width), static_cast<float>(height) });
+		ControlContainer::GetInstance().Invalidate({ 0.f, 0.f, static_cast<float>(width), static_cast<float>(height) });
+		Frame();
+	}
+
+	// Hands event to the application; pointer moves wait for the next frame.
+	void Post(InputEvent const& event) {
+		auto start = std::chrono::steady_clock::now();
+		if (event.kind == InputEvent::Kind::Resize) {
+			int width = static_cast<int>(event.size.width), height = static_cast<int>(event.size.height);
+			_renderer.Resize(width, height);
+			ControlContainer::GetInstance().Invalidate({ 0.f, 0.f, static_cast<float>(width), static_cast<float>(height) });
+		}
+		_application.Post(event);
+		_waiting.push_back(event.time);
+		++_stats.events;
+		_stats.busy += std::chrono::steady_clock::now() - start;
+	}
+
+	// Runs finished background work, delivers waiting input and paints
+	// whatever has been invalidated.
+	// Returns false if nothing was.
+	bool Frame() {
+		auto start = std::chrono::steady_clock::now();
+		// Background results that are back stand in for the window's queue message.
+		UiQueue::GetInstance().Drain();
+		_application.Pump();
+		auto& controls = ControlContainer::GetInstance();
+		auto const& target = _renderer.Target();
+		Rect dirty = IntersectRectangle(controls.TakeDirty(),
+			{ 0.f, 0.f, static_cast<float>(target.width), static_cast<float>(target.height) });
+		bool painted = !RectangleIsEmpty(dirty);
+		if (painted) {
+			_renderer.PushClip(dirty);
+			_renderer.Clear(backgroundColor);
+			controls.Paint(_renderer, dirty);
+			_renderer.PopClip();
+			_renderer.EndFrame();
+			++_stats.frames;
+			// The framebuffer is the display; what was handled is now shown.
+			InputLatency::GetInstance().Presented();
+		}
+		auto end = std::chrono::steady_clock::now();
+		_stats.busy += end - start;
+		for (auto time : _waiting) {
+			_latencies.push_back(end - time);
+			_stats.maxLatency = (std::max)(_stats.maxLatency, end - time);
+		}
+		_waiting.clear();
+		return painted;
+	}
+
+	// Posts event and paints the frame it causes. Returns its latency.
+	std::chrono::steady_clock::duration Send(InputEvent const& event) {
+		Post(event);
+		Frame();
+		return _latencies.back();
+	}
+
+	Framebuffer const& Target() const {
+		return _renderer.Target();
+	}
+
+	DriverStats const& Stats() const {
+		return _stats;
+	}
+
+	std::vector<std::chrono::steady_clock::duration> const& Latencies() const {
+		return _latencies;
+	}
+};
+
+// Plain-text summary of a headless run: latency percentiles over every event
+// the driver measured, its throughput and how many moves were coalesced.
+inline std::string LatencyReport(HeadlessDriver const& driver, InputBatcherStats const& batching) {
+	auto latencies = driver.Latencies();
+	if (latencies.empty()) {
+		return "no events\n";
+	}
+	std::sort(latencies.begin(), latencies.end());
+	auto us = [](std::chrono::steady_clock::duration d) {
+		return std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
+	};
+	auto percentile = [&](std::size_t p) {
+		return us(latencies[(latencies.size() - 1) * p / 100]);
+	};
+	DriverStats const& stats = driver.Stats();
+	auto seconds = std::chrono::duration<double>(stats.busy).count();
+	std::string report;
+	report += "events " + std::to_string(stats.events) + ", frames " + std::to_string(stats.frames)
+		+ ", moves coalesced " + std::to_string(batching.coalesced) + "\n";
+	report += "latency p50 " + percentile(50) + " us, p90 " + percentile(90) + " us, p99 " + percentile(99) + " us, max " + us(latencies.back()) + " us\n";
+	report += "throughput " + std::to_string(seconds > 0 ? static_cast<long long>(static_cast<double>(stats.events) / seconds) : 0) + " events/s\n";
+	return report;
+}
+
+// Builds an Application into an empty container and sends it a scripted
+// session: pointer sweeps across the controls, clicks into the input,
+// typing with corrections and wheel scrolling. The session runs twice, once
+// painting after every event and once with a frame every eighth event, as
+// from a 1000 Hz mouse on a 125 Hz display. Returns a plain-text report of
+// event-to-pixels latency and throughput for both, with the keystroke stages.
+inline std::string RunInputBenchmark(int rounds = 50) {
+	constexpr int width = 400, height = 500;
+	auto run = [&](int eventsPerFrame) {
+		InputLatency::GetInstance().Reset();
+		Application application;
+		HeadlessDriver driver{ application, width, height };
+		auto const& ui = application.Handles();
+		auto& controls = ControlContainer::GetInstance();
+		auto center = [&](ControlHandle handle) {
+			Rect area = controls.Get<Control>(handle)->Area();
+			return Point{ (area.left + area.right) / 2.f, (area.top + area.bottom) / 2.f };
+		};
+
+		int sent = 0;
+		auto send = [&](InputEvent const& event) {
+			driver.Post(event);
+			if (++sent % eventsPerFrame == 0) {
+				driver.Frame();
+			}
+		};
+		for (int round = 0; round < rounds; ++round) {
+			for (int step = 0; step < 40; ++step) {
+				send(InputEvent::PointerMove({ static_cast<float>(step * 10 % width), static_cast<float>(step * 37 % height) }));
+			}
+			send(InputEvent::PointerDown(center(ui.input)));
+			send(InputEvent::PointerUp(center(ui.input)));
+			for (wchar_t ch : std::wstring_view{ L"headless" }) {
+				send(InputEvent::Char(ch));
+			}
+			for (int i = 0; i < 4; ++i) {
+				send(InputEvent::Char(L'\b'));
+			}
+			send(InputEvent::Wheel(center(ui.numbers), round % 2 ? 120 * 3 : -120 * 3));
+		}
+		driver.Frame();
+		return LatencyReport(driver, application.Batcher().Stats()) + InputLatency::GetInstance().Report();
+	};
+	return "every event:\n" + run(1) + "every 8 events:\n" + run(8);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include "Geometry.h"
+
+// Platform-neutral input, including client-area resizes. Points are in
+// client coordinates; key codes are the platform's virtual-key codes, as
+// with Control::OnKeyDown.
+struct InputEvent {
+	enum class Kind : std::uint8_t {
+		PointerMove,
+		PointerDown,
+		PointerUp,
+		Wheel,
+		Char,
+		Key,
+		Resize,
+	};
+
+	Kind kind{ Kind::PointerMove };
+	Point point{};
+	// Wheel distance, in the platform's units (120 per notch on Windows).
+	int delta{ 0 };
+	unsigned key{ 0 };
+	wchar_t ch{ 0 };
+	Size size{};
+	// When the event happened, for measuring input latency.
+	std::chrono::steady_clock::time_point time{ std::chrono::steady_clock::now() };
+
+	static InputEvent PointerMove(Point point) { return { Kind::PointerMove, point }; }
+	static InputEvent PointerDown(Point point) { return { Kind::PointerDown, point }; }
+	static InputEvent PointerUp(Point point) { return { Kind::PointerUp, point }; }
+	static InputEvent Wheel(Point point, int delta) { return { Kind::Wheel, point, delta }; }
+	static InputEvent Char(wchar_t ch) { return { Kind::Char, {}, 0, 0, ch }; }
+	static InputEvent Key(unsigned key) { return { Kind::Key, {}, 0, key }; }
+	static InputEvent Resize(Size size) { return { Kind::Resize, {}, 0, 0, 0, size }; }
+};
@@ -0,0 +1,82 @@
+#pragma once
+#include <cstddef>
+#include <span>
+#include <vector>
+#include "Input.h"
+
+struct InputBatcherStats {
+	std::size_t received{ 0 };
+	std::size_t delivered{ 0 };
+	std::size_t coalesced{ 0 };
+};
+
+// Holds input until the next frame. A pointer move that directly follows
+// another replaces it, so only the latest position is hit-tested, but keeps
+// the earlier move's timestamp so latency still counts from the first move
+// that waited. Everything else is kept in order. With history enabled every
+// position is also kept, for controls that trace the whole path.
+class InputBatcher {
+private:
+	std::vector<InputEvent> _pending;
+	std::vector<Point> _history;
+	// Positions the running drain delivered, which it drops when done.
+	std::size_t _traced{ 0 };
+	bool _keepHistory{ false };
+	InputBatcherStats _stats;
+
+public:
+	void KeepHistory(bool keep) {
+		_keepHistory = keep;
+		_history.clear();
+		_traced = 0;
+	}
+
+	void Push(InputEvent const& event) {
+		++_stats.received;
+		if (event.kind == InputEvent::Kind::PointerMove) {
+			if (_keepHistory) {
+				_history.push_back(event.point);
+			}
+			if (!_pending.empty() && _pending.back().kind == InputEvent::Kind::PointerMove) {
+				_pending.back().point = event.point;
+				++_stats.coalesced;
+				return;
+			}
+		}
+		_pending.push_back(event);
+	}
+
+	bool Empty() const {
+		return _pending.empty();
+	}
+
+	// Hands the held events to deliver in order. Events pushed meanwhile wait
+	// for the next drain.
+	template <typename F>
+	void Drain(F&& deliver) {
+		std::vector<InputEvent> events;
+		events.swap(_pending);
+		_traced = _history.size();
+		for (InputEvent const& event : events) {
+			++_stats.delivered;
+			deliver(event);
+		}
+		// deliver may have changed the history through KeepHistory or Push.
+		_history.erase(_history.begin(), _history.begin() + static_cast<std::ptrdiff_t>(_traced));
+		_traced = 0;
+		events.clear();
+		if (_pending.empty()) {
+			_pending.swap(events);
+		}
+	}
+
+	// Every pointer position since the last drain, oldest first. During a
+	// drain this includes the moves that were coalesced away.
+	std::span<Point const> History() const {
+		return _history;
+	}
+
+	InputBatcherStats const& Stats() const {
+		return _stats;
+	}
+};
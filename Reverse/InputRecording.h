@@ -0,0 +1,233 @@
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Input.h"
+#include "HeadlessDriver.h"
+
+// A recorded session is the bytes "RVIN", a version byte, then one record per
+// event: the microseconds since the previous event and the event kind, both
+// as varints, followed by the kind's fields. Coordinates and sizes are whole
+// client pixels, stored zigzag-encoded so small values stay one or two bytes.
+struct RecordedInput {
+	std::chrono::microseconds delay;
+	InputEvent event;
+};
+
+namespace InputFormat {
+	constexpr char magic[4]{ 'R', 'V', 'I', 'N' };
+	constexpr std::uint8_t version = 1;
+
+	inline void PutVarint(std::vector<std::uint8_t>& out, std::uint64_t value) {
+		while (value >= 0x80) {
+			out.push_back(static_cast<std::uint8_t>(value | 0x80));
+			value >>= 7;
+		}
+		out.push_back(static_cast<std::uint8_t>(value));
+	}
+
+	inline void PutSigned(std::vector<std::uint8_t>& out, float value) {
+		auto v = static_cast<std::int64_t>(std::lround(value));
+		PutVarint(out, static_cast<std::uint64_t>(v) << 1 ^ static_cast<std::uint64_t>(v >> 63));
+	}
+
+	class Reader {
+	private:
+		std::vector<std::uint8_t> const& _bytes;
+		std::size_t _at;
+
+	public:
+		Reader(std::vector<std::uint8_t> const& bytes, std::size_t at) : _bytes{ bytes }, _at{ at } {}
+
+		bool Done() const {
+			return _at == _bytes.size();
+		}
+
+		std::uint64_t Varint() {
+			std::uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7) {
+				if (_at == _bytes.size()) {
+					throw std::runtime_error("Truncated input recording");
+				}
+				std::uint8_t byte = _bytes[_at++];
+				value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+				if (!(byte & 0x80)) {
+					return value;
+				}
+			}
+			throw std::runtime_error("Malformed input recording");
+		}
+
+		float Signed() {
+			std::uint64_t v = Varint();
+			return static_cast<float>(static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1));
+		}
+
+		Point ReadPoint() {
+			float x = Signed();
+			return { x, Signed() };
+		}
+	};
+}
+
+// Appends every event it is given to an in-memory recording.
+class InputRecorder {
+private:
+	std::vector<std::uint8_t> _bytes;
+	std::chrono::steady_clock::time_point _last{ std::chrono::steady_clock::now() };
+	std::size_t _events{ 0 };
+
+public:
+	InputRecorder() {
+		_bytes.assign(std::begin(InputFormat::magic), std::end(InputFormat::magic));
+		_bytes.push_back(InputFormat::version);
+	}
+
+	void Record(InputEvent const& event) {
+		using namespace InputFormat;
+		auto delay = std::chrono::duration_cast<std::chrono::microseconds>(event.time - _last);
+		_last = event.time;
+		PutVarint(_bytes, static_cast<std::uint64_t>((std::max)(delay.count(), std::int64_t{ 0 })));
+		PutVarint(_bytes, static_cast<std::uint64_t>(event.kind));
+		switch (event.kind) {
+		case InputEvent::Kind::PointerMove:
+		case InputEvent::Kind::PointerDown:
+		case InputEvent::Kind::PointerUp:
+			PutSigned(_bytes, event.point.x);
+			PutSigned(_bytes, event.point.y);
+			break;
+		case InputEvent::Kind::Wheel:
+			PutSigned(_bytes, event.point.x);
+			PutSigned(_bytes, event.point.y);
+			PutSigned(_bytes, static_cast<float>(event.delta));
+			break;
+		case InputEvent::Kind::Char: PutVarint(_bytes, static_cast<std::uint64_t>(event.ch)); break;
+		case InputEvent::Kind::Key: PutVarint(_bytes, event.key); break;
+		case InputEvent::Kind::Resize:
+			PutSigned(_bytes, event.size.width);
+			PutSigned(_bytes, event.size.height);
+			break;
+		}
+		++_events;
+	}
+
+	std::vector<std::uint8_t> const& Bytes() const {
+		return _bytes;
+	}
+
+	std::size_t Events() const {
+		return _events;
+	}
+
+	bool Save(std::filesystem::path const& path) const {
+		std::ofstream out{ path, std::ios::binary };
+		out.write(reinterpret_cast<char const*>(_bytes.data()), static_cast<std::streamsize>(_bytes.size()));
+		return static_cast<bool>(out);
+	}
+};
+
+inline std::vector<RecordedInput> ParseInput(std::vector<std::uint8_t> const& bytes) {
+	using namespace InputFormat;
+	if (bytes.size() < sizeof(magic) + 1 || !std::equal(std::begin(magic), std::end(magic), bytes.begin())) {
+		throw std::runtime_error("Not an input recording");
+	}
+	if (bytes[sizeof(magic)] != version) {
+		throw std::runtime_error("Unsupported input recording version");
+	}
+	std::vector<RecordedInput> session;
+	Reader in{ bytes, sizeof(magic) + 1 };
+	while (!in.Done()) {
+		RecordedInput record{ std::chrono::microseconds{ static_cast<std::int64_t>(in.Varint()) }, {} };
+		InputEvent& event = record.event;
+		auto kind = in.Varint();
+		if (kind > static_cast<std::uint64_t>(InputEvent::Kind::Resize)) {
+			throw std::runtime_error("Unknown event in input recording");
+		}
+		event.kind = static_cast<InputEvent::Kind>(kind);
+		switch (event.kind) {
+		case InputEvent::Kind::PointerMove:
+		case InputEvent::Kind::PointerDown:
+		case InputEvent::Kind::PointerUp:
+			event.point = in.ReadPoint();
+			break;
+		case InputEvent::Kind::Wheel:
+			event.point = in.ReadPoint();
+			event.delta = static_cast<int>(in.Signed());
+			break;
+		case InputEvent::Kind::Char: event.ch = static_cast<wchar_t>(in.Varint()); break;
+		case InputEvent::Kind::Key: event.key = static_cast<unsigned>(in.Varint()); break;
+		case InputEvent::Kind::Resize: {
+			float width = in.Signed();
+			event.size = { width, in.Signed() };
+			break;
+		}
+		}
+		session.push_back(record);
+	}
+	return session;
+}
+
+inline std::vector<RecordedInput> LoadInput(std::filesystem::path const& path) {
+	std::ifstream in{ path, std::ios::binary };
+	if (!in) {
+		throw std::runtime_error("Cannot open input recording");
+	}
+	return ParseInput({ std::istreambuf_iterator<char>{ in }, std::istreambuf_iterator<char>{} });
+}
+
+enum class ReplaySpeed {
+	// Events are sent at their recorded times; latency includes any time an
+	// event had to wait behind the previous frame.
+	Recorded,
+	// Each event is sent as soon as the previous frame is done.
+	Maximum,
+};
+
+// Builds an Application into an empty container and replays session through
+// a HeadlessDriver. The first frame uses the session's leading resize, if
+// it has one. Without a frame interval every event is painted on its own;
+// with one, frames fall on that interval of recorded time and the moves
+// between them are coalesced. Returns the driver's latency report followed by
+// the keystroke stages.
+inline std::string ReplayInput(std::vector<RecordedInput> const& session, ReplaySpeed speed,
+	std::chrono::microseconds frameInterval = std::chrono::microseconds{ 0 }) {
+	Size size{ 600.f, 600.f };
+	if (!session.empty() && session.front().event.kind == InputEvent::Kind::Resize) {
+		size = session.front().event.size;
+	}
+	InputLatency::GetInstance().Reset();
+	Application application;
+	HeadlessDriver driver{ application, static_cast<int>(size.width), static_cast<int>(size.height) };
+	auto due = std::chrono::steady_clock::now();
+	std::chrono::microseconds recorded{ 0 }, nextFrame{ frameInterval };
+	for (RecordedInput const& record : session) {
+		recorded += record.delay;
+		if (frameInterval.count() > 0 && recorded >= nextFrame) {
+			driver.Frame();
+			nextFrame = (recorded / frameInterval + 1) * frameInterval;
+		}
+		InputEvent event = record.event;
+		if (speed == ReplaySpeed::Recorded) {
+			due += record.delay;
+			std::this_thread::sleep_until(due);
+			event.time = due;
+		}
+		else {
+			event.time = std::chrono::steady_clock::now();
+		}
+		driver.Post(event);
+		if (frameInterval.count() == 0) {
+			driver.Frame();
+		}
+	}
+	driver.Frame();
+	return LatencyReport(driver, application.Batcher().Stats()) + InputLatency::GetInstance().Report();
+}
@@ -0,0 +1,227 @@
+#pragma once
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Counts durations in log-linear microsecond buckets: exact below 8 us, then
+// eight buckets per power of two, so any percentile is within 12.5%. Record
+// only touches atomics and never blocks, so any thread may record or read
+// while another records; a read may miss samples still being recorded.
+class LatencyHistogram {
+public:
+	using Duration = std::chrono::steady_clock::duration;
+
+private:
+	static constexpr std::uint64_t subBuckets = 8;
+	// Up to 2^32 us, a little over an hour; longer samples land in the last bucket.
+	static constexpr std::size_t bucketCount = (32 - 2) * subBuckets;
+
+	std::array<std::atomic<std::uint64_t>, bucketCount> _buckets{};
+	std::atomic<std::uint64_t> _count{ 0 };
+	std::atomic<std::uint64_t> _sum{ 0 };
+	std::atomic<std::uint64_t> _max{ 0 };
+
+	static std::size_t Bucket(std::uint64_t us) {
+		if (us < subBuckets) {
+			return static_cast<std::size_t>(us);
+		}
+		int shift = std::bit_width(us) - 4;
+		std::size_t bucket = static_cast<std::size_t>(shift + 1) * subBuckets + static_cast<std::size_t>((us >> shift) & (subBuckets - 1));
+		return (std::min)(bucket, bucketCount - 1);
+	}
+
+	// The largest value that lands in bucket.
+	static std::uint64_t UpperBound(std::size_t bucket) {
+		if (bucket < subBuckets) {
+			return bucket;
+		}
+		int shift = static_cast<int>(bucket / subBuckets) - 1;
+		std::uint64_t mantissa = bucket % subBuckets + subBuckets;
+		return ((mantissa + 1) << shift) - 1;
+	}
+
+public:
+	void Record(Duration duration) {
+		auto us = static_cast<std::uint64_t>((std::max)(std::chrono::duration_cast<std::chrono::microseconds>(duration).count(), std::int64_t{ 0 }));
+		_buckets[Bucket(us)].fetch_add(1, std::memory_order_relaxed);
+		_count.fetch_add(1, std::memory_order_relaxed);
+		_sum.fetch_add(us, std::memory_order_relaxed);
+		std::uint64_t max = _max.load(std::memory_order_relaxed);
+		while (us > max && !_max.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+		}
+	}
+
+	std::uint64_t Count() const {
+		return _count.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t MaxMicroseconds() const {
+		return _max.load(std::memory_order_relaxed);
+	}
+
+	std::uint64_t MeanMicroseconds() const {
+		std::uint64_t count = Count();
+		return count ? _sum.load(std::memory_order_relaxed) / count : 0;
+	}
+
+	// The bucket bound at or below which percent of the samples fall.
+	std::uint64_t PercentileMicroseconds(double percent) const {
+		std::vector<std::uint64_t> counts(bucketCount);
+		std::uint64_t total = 0;
+		for (std::size_t i = 0; i < bucketCount; ++i) {
+			total += counts[i] = _buckets[i].load(std::memory_order_relaxed);
+		}
+		if (!total) {
+			return 0;
+		}
+		auto rank = static_cast<std::uint64_t>(std::ceil(percent / 100.0 * static_cast<double>(total)));
+		std::uint64_t seen = 0;
+		for (std::size_t i = 0; i < bucketCount; ++i) {
+			seen += counts[i];
+			if (seen >= (std::max)(rank, std::uint64_t{ 1 })) {
+				return (std::min)(UpperBound(i), MaxMicroseconds());
+			}
+		}
+		return MaxMicroseconds();
+	}
+
+	void Reset() {
+		for (auto& bucket : _buckets) {
+			bucket.store(0, std::memory_order_relaxed);
+		}
+		_count.store(0, std::memory_order_relaxed);
+		_sum.store(0, std::memory_order_relaxed);
+		_max.store(0, std::memory_order_relaxed);
+	}
+
+	// "n 12, mean 40 us, p50 31 us, p99 120 us, max 131 us"
+	std::string Summary() const {
+		return "n " + std::to_string(Count())
+			+ ", mean " + std::to_string(MeanMicroseconds())
+			+ " us, p50 " + std::to_string(PercentileMicroseconds(50))
+			+ " us, p99 " + std::to_string(PercentileMicroseconds(99))
+			+ " us, max " + std::to_string(MaxMicroseconds()) + " us";
+	}
+};
+
+// Where a keystroke's time goes on its way to the screen.
+enum class LatencyStage : std::uint8_t {
+	// From the message's timestamp until the application starts handling it.
+	Queue,
+	// Dispatching it to the controls, including the change handlers.
+	Handle,
+	// The change handlers alone. For WhenChangeAsync, from the change until
+	// its result has been applied, background work included.
+	Change,
+	// From being handled until a frame showing it, and the result of any
+	// background change it started, is presented.
+	Present,
+	// From the message's timestamp until presented.
+	Total,
+};
+constexpr std::size_t latencyStageCount = 5;
+
+// One histogram per stage for keystrokes. The histograms may be read from any
+// thread; Handled and Presented belong to the UI thread.
+class InputLatency {
+public:
+	using Clock = std::chrono::steady_clock;
+
+private:
+	struct Unpresented {
+		Clock::time_point message;
+		Clock::time_point handled;
+		// Waiting for a background change to be applied.
+		bool deferred;
+	};
+
+	std::array<LatencyHistogram, latencyStageCount> _stages;
+	std::vector<Unpresented> _unpresented;
+	bool _deferring{ false };
+
+	InputLatency() = default;
+
+public:
+	static InputLatency& GetInstance() {
+		static InputLatency instance;
+		return instance;
+	}
+
+	void Record(LatencyStage stage, LatencyHistogram::Duration duration) {
+		_stages[static_cast<std::size_t>(stage)].Record(duration);
+	}
+
+	// A keystroke stamped message was handled, starting at start. One that
+	// invalidated nothing and left no background change has nothing left to
+	// show, so it counts as presented right away.
+	void Handled(Clock::time_point message, Clock::time_point start, bool invalidated) {
+		auto now = Clock::now();
+		Record(LatencyStage::Queue, start - message);
+		Record(LatencyStage::Handle, now - start);
+		if (!invalidated && !_deferring) {
+			Record(LatencyStage::Present, {});
+			Record(LatencyStage::Total, now - message);
+			return;
+		}
+		_unpresented.push_back({ message, now, _deferring });
+		_deferring = false;
+	}
+
+	// A change handler left work in the background while the current
+	// keystroke was handled; the keystroke waits for ChangeApplied.
+	void ChangeDeferred() {
+		_deferring = true;
+	}
+
+	// The latest background change was applied. Later changes supersede
+	// earlier ones, so it covers every keystroke handled so far.
+	void ChangeApplied() {
+		for (auto& keystroke : _unpresented) {
+			keystroke.deferred = false;
+		}
+		_deferring = false;
+	}
+
+	// Call once a frame that painted something has been presented; every
+	// keystroke handled before it, and not waiting for a background change,
+	// is now on screen.
+	void Presented() {
+		auto now = Clock::now();
+		std::erase_if(_unpresented, [&](Unpresented const& keystroke) {
+			if (keystroke.deferred) {
+				return false;
+			}
+			Record(LatencyStage::Present, now - keystroke.handled);
+			Record(LatencyStage::Total, now - keystroke.message);
+			return true;
+		});
+	}
+
+	LatencyHistogram const& Stage(LatencyStage stage) const {
+		return _stages[static_cast<std::size_t>(stage)];
+	}
+
+	void Reset() {
+		for (auto& stage : _stages) {
+			stage.Reset();
+		}
+		_unpresented.clear();
+		_deferring = false;
+	}
+
+	std::string Report() const {
+		constexpr char const* names[latencyStageCount]{ "queue", "handle", "change", "present", "total" };
+		std::string report;
+		for (std::size_t i = 0; i < latencyStageCount; ++i) {
+			report += std::string{ names[i] } + ": " + _stages[i].Summary() + "\n";
+		}
+		return report;
+	}
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include "Renderer.h"
+
+struct LayerStats {
+	std::size_t hits{ 0 };
+	std::size_t misses{ 0 };
+	std::size_t evictions{ 0 };
+	std::size_t bytes{ 0 };
+	std::size_t entries{ 0 };
+};
+
+// Holds one rendered bitmap per control within a memory budget. A layer is
+// only returned while its version matches; once the budget is exceeded the
+// least recently composited layers are dropped first.
+template<typename Bitmap>
+class LayerCache {
+private:
+	struct Entry {
+		LayerKey key;
+		Bitmap bitmap;
+		std::size_t bytes;
+	};
+	struct KeyHash {
+		std::size_t operator()(std::pair<std::uint64_t, std::uint64_t> const& key) const {
+			return std::hash<std::uint64_t>{}(key.first * 0x9E3779B97F4A7C15ull ^ key.second);
+		}
+	};
+	using Slot = std::pair<std::uint64_t, std::uint64_t>;
+
+	// Most recently used at the front.
+	std::list<Entry> _lru;
+	std::unordered_map<Slot, typename std::list<Entry>::iterator, KeyHash> _index;
+	std::size_t _budget;
+	LayerStats _stats;
+
+	void Erase(typename std::list<Entry>::iterator it) {
+		_stats.bytes -= it->bytes;
+		_index.erase(Slot{ it->key.owner, it->key.item });
+		_lru.erase(it);
+	}
+
+public:
+	explicit LayerCache(std::size_t budget = 8u << 20) : _budget{ budget } {}
+
+	// The up-to-date layer for key, or null. A stale layer is dropped.
+	Bitmap const* Find(LayerKey key) {
+		auto found = _index.find(Slot{ key.owner, key.item });
+		if (found == _index.end()) {
+			++_stats.misses;
+			return nullptr;
+		}
+		auto it = found->second;
+		if (it->key.version != key.version) {
+			Erase(it);
+			++_stats.misses;
+			return nullptr;
+		}
+		_lru.splice(_lru.begin(), _lru, it);
+		++_stats.hits;
+		// std::addressof: COM smart pointers overload operator&.
+		return std::addressof(it->bitmap);
+	}
+
+	// Whether Find would succeed, without counting or reordering anything.
+	bool Contains(LayerKey key) const {
+		auto found = _index.find(Slot{ key.owner, key.item });
+		return found != _index.end() && found->second->key.version == key.version;
+	}
+
+	// Layers larger than the whole budget are not kept.
+	void Store(LayerKey key, Bitmap bitmap, std::size_t bytes) {
+		if (auto found = _index.find(Slot{ key.owner, key.item }); found != _index.end()) {
+			Erase(found->second);
+		}
+		if (bytes > _budget) {
+			return;
+		}
+		while (_stats.bytes + bytes > _budget) {
+			Erase(std::prev(_lru.end()));
+			++_stats.evictions;
+		}
+		_lru.push_front({ key, std::move(bitmap), bytes });
+		_index.emplace(Slot{ key.owner, key.item }, _lru.begin());
+		_stats.bytes += bytes;
+	}
+
+	std::size_t Budget() const {
+		return _budget;
+	}
+
+	void Clear() {
+		_lru.clear();
+		_index.clear();
+		_stats.bytes = 0;
+	}
+
+	LayerStats Stats() const {
+		LayerStats stats = _stats;
+		stats.entries = _lru.size();
+		return stats;
+	}
+};
@@ -0,0 +1,160 @@
+#pragma once
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "Geometry.h"
+
+// A flex-style layout tree. Each node stacks its children along its axis;
+// children with a fixed size keep it, and the remaining space is shared out
+// by grow factor. Along the cross axis a child stretches unless it has a
+// fixed size.
+//
+// Layout is incremental: a node whose constraints have not changed and that
+// is handed the same bounds as last time is skipped together with its whole
+// subtree. Measured sizes are cached until a constraint below them changes.
+class LayoutNode {
+public:
+	enum class Axis { Horizontal, Vertical };
+	static constexpr float automatic = -1.f;
+
+private:
+	Axis _axis{ Axis::Vertical };
+	Size _fixed{ automatic, automatic };
+	float _grow{ 0.f };
+	float _padding{ 0.f };
+	float _gap{ 0.f };
+	std::function<void(Rect)> _arrange;
+
+	LayoutNode* _parent{ nullptr };
+	std::vector<std::unique_ptr<LayoutNode>> _children;
+
+	Rect _bounds{};
+	Size _measured{};
+	bool _layoutDirty{ true };
+	bool _measureDirty{ true };
+
+	float Main(Size size) const { return _axis == Axis::Vertical ? size.height : size.width; }
+	float Cross(Size size) const { return _axis == Axis::Vertical ? size.width : size.height; }
+
+	std::size_t LayoutChildren() {
+		Rect inner{ _bounds.left + _padding, _bounds.top + _padding, _bounds.right - _padding, _bounds.bottom - _padding };
+		float available = _axis == Axis::Vertical ? inner.Height() : inner.Width();
+		float crossAvailable = _axis == Axis::Vertical ? inner.Width() : inner.Height();
+
+		float used = _children.empty() ? 0.f : _gap * static_cast<float>(_children.size() - 1);
+		float totalGrow = 0.f;
+		for (auto& child : _children) {
+			used += Main(child->Measure());
+			totalGrow += child->_grow;
+		}
+		float freeSpace = (std::max)(0.f, available - used);
+
+		std::size_t laidOut = 0;
+		float offset = _axis == Axis::Vertical ? inner.top : inner.left;
+		for (auto& child : _children) {
+			float main = Main(child->Measure());
+			if (totalGrow > 0.f) {
+				main += freeSpace * child->_grow / totalGrow;
+			}
+			float fixedCross = Cross(child->_fixed);
+			float cross = fixedCross >= 0.f ? fixedCross : crossAvailable;
+			Rect rect = _axis == Axis::Vertical
+				? Rect{ inner.left, offset, inner.left + cross, offset + main }
+				: Rect{ offset, inner.top, offset + main, inner.top + cross };
+			laidOut += child->Layout(rect);
+			offset += main + _gap;
+		}
+		return laidOut;
+	}
+
+public:
+	LayoutNode() = default;
+	LayoutNode(std::function<void(Rect)> arrange) : _arrange(std::move(arrange)) {}
+
+	LayoutNode(LayoutNode const&) = delete;
+	LayoutNode& operator=(LayoutNode const&) = delete;
+
+	LayoutNode& Append(std::unique_ptr<LayoutNode> child) {
+		child->_parent = this;
+		_children.emplace_back(std::move(child));
+		Invalidate();
+		return *_children.back();
+	}
+
+	LayoutNode& Append(std::function<void(Rect)> arrange = {}) {
+		return Append(std::make_unique<LayoutNode>(std::move(arrange)));
+	}
+
+	// Marks this node and its ancestors for re-measure and re-layout. Siblings
+	// are left alone unless the parent hands them different bounds.
+	void Invalidate() {
+		for (auto node = this; node && !(node->_layoutDirty && node->_measureDirty); node = node->_parent) {
+			node->_layoutDirty = node->_measureDirty = true;
+		}
+	}
+
+	LayoutNode& SetAxis(Axis axis) {
+		if (_axis != axis) { _axis = axis; Invalidate(); }
+		return *this;
+	}
+	LayoutNode& SetSize(Size fixed) {
+		if (!(_fixed == fixed)) { _fixed = fixed; Invalidate(); }
+		return *this;
+	}
+	LayoutNode& SetGrow(float grow) {
+		if (_grow != grow) { _grow = grow; Invalidate(); }
+		return *this;
+	}
+	LayoutNode& SetPadding(float padding) {
+		if (_padding != padding) { _padding = padding; Invalidate(); }
+		return *this;
+	}
+	LayoutNode& SetGap(float gap) {
+		if (_gap != gap) { _gap = gap; Invalidate(); }
+		return *this;
+	}
+
+	// Natural size: the fixed size where set, otherwise what the children need.
+	Size Measure() {
+		if (!_measureDirty) {
+			return _measured;
+		}
+		float main = 0.f, cross = 0.f;
+		for (auto& child : _children) {
+			Size size = child->Measure();
+			main += Main(size);
+			cross = (std::max)(cross, Cross(size));
+		}
+		if (!_children.empty()) {
+			main += _gap * static_cast<float>(_children.size() - 1);
+		}
+		main += 2.f * _padding;
+		cross += 2.f * _padding;
+		Size natural = _axis == Axis::Vertical ? Size{ cross, main } : Size{ main, cross };
+		_measured = {
+			_fixed.width >= 0.f ? _fixed.width : natural.width,
+			_fixed.height >= 0.f ? _fixed.height : natural.height
+		};
+		_measureDirty = false;
+		return _measured;
+	}
+
+	// Returns how many nodes were actually laid out.
+	std::size_t Layout(Rect bounds) {
+		if (!_layoutDirty && bounds == _bounds) {
+			return 0;
+		}
+		_bounds = bounds;
+		if (_arrange) {
+			_arrange(bounds);
+		}
+		std::size_t laidOut = 1 + LayoutChildren();
+		_layoutDirty = false;
+		return laidOut;
+	}
+
+	Rect const& Bounds() const {
+		return _bounds;
+	}
+};
@@ -0,0 +1,127 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include "Geometry.h"
+
+class DisplayList;
+
+struct Color {
+	float r{ 0.f };
+	float g{ 0.f };
+	float b{ 0.f };
+	float a{ 1.f };
+
+	static constexpr Color FromRgb(std::uint32_t rgb, float alpha = 1.f) {
+		return { ((rgb >> 16) & 0xFF) / 255.f, ((rgb >> 8) & 0xFF) / 255.f, (rgb & 0xFF) / 255.f, alpha };
+	}
+
+	bool operator==(Color const&) const = default;
+};
+
+// Linear blend: t = 0 gives from, t = 1 gives to.
+constexpr Color MixColor(Color from, Color to, float t) {
+	return { from.r + (to.r - from.r) * t, from.g + (to.g - from.g) * t,
+		from.b + (to.b - from.b) * t, from.a + (to.a - from.a) * t };
+}
+
+// Brushes are named rather than referenced so that recorded commands do not
+// depend on any rendering API.
+enum class Brush : std::uint8_t {
+	ButtonNormal,
+	ButtonHover,
+	TextWrite,
+	TextBoxBorder,
+};
+
+constexpr std::size_t brushCount = 4;
+
+// The palette every backend resolves brushes against.
+constexpr Color BrushColor(Brush brush) {
+	switch (brush) {
+	case Brush::ButtonNormal: return Color::FromRgb(0xF7F7F7);
+	case Brush::ButtonHover: return Color::FromRgb(0xEAEAEA);
+	case Brush::TextBoxBorder: return Color::FromRgb(0x808080);
+	default: return Color::FromRgb(0x000000);
+	}
+}
+
+constexpr Color backgroundColor = Color::FromRgb(0xFFFFFF);
+
+// Identifies a piece of text across frames so its layout can be cached:
+// owner is the drawing control, item tells apart several texts it draws, and
+// version changes whenever the text does. An owner of 0 opts out of caching.
+struct TextKey {
+	std::uint64_t owner{ 0 };
+	std::uint64_t item{ 0 };
+	std::uint32_t version{ 0 };
+};
+
+// Names a control's cached layer the same way: version changes whenever the
+// control looks different.
+using LayerKey = TextKey;
+
+struct TextRun {
+	Rect rect;
+	std::wstring_view text;
+	TextKey key;
+};
+
+// What controls draw onto. Text is laid out centred in its rectangle in the
+// fixed-pitch UI font.
+class Renderer {
+public:
+	virtual ~Renderer() = default;
+
+	virtual void Clear(Color color) = 0;
+	virtual void FillRectangle(Rect rect, Brush brush) = 0;
+	// For colours outside the palette, e.g. in the middle of a transition.
+	virtual void FillSolid(Rect rect, Color color) = 0;
+	virtual void DrawRectangle(Rect rect, Brush brush) = 0;
+	virtual void DrawText(Rect rect, std::wstring_view text, Brush brush, TextKey key) = 0;
+	virtual void PushClip(Rect rect) = 0;
+	virtual void PopClip() = 0;
+
+	// Batched forms, one call for many primitives sharing a brush. Backends
+	// that can do better than a loop override them.
+	virtual void FillRectangles(std::span<Rect const> rects, Brush brush) {
+		for (auto const& rect : rects) {
+			FillRectangle(rect, brush);
+		}
+	}
+	virtual void DrawRectangles(std::span<Rect const> rects, Brush brush) {
+		for (auto const& rect : rects) {
+			DrawRectangle(rect, brush);
+		}
+	}
+	virtual void DrawTexts(std::span<TextRun const> runs, Brush brush) {
+		for (auto const& run : runs) {
+			DrawText(run.rect, run.text, brush, run.key);
+		}
+	}
+
+	// Layers are optional: backends without them draw every control directly.
+	// Between BeginLayer and EndLayer drawing goes to a fresh transparent
+	// bitmap covering area, which EndLayer keeps under key for DrawLayer to
+	// composite, now and in later frames while the key stays the same.
+	// CanLayer tells whether a layer of that size would be kept at all.
+	virtual bool CanLayer(Rect /*area*/) const {
+		return false;
+	}
+	virtual bool HasLayer(LayerKey /*key*/) const {
+		return false;
+	}
+	virtual bool DrawLayer(LayerKey /*key*/, Rect /*area*/) {
+		return false;
+	}
+	// Draws the layer, or replays fallback when there is none. A renderer
+	// that draws later than it is called must still replay fallback if the
+	// layer is gone by then.
+	virtual void DrawLayerOr(LayerKey key, Rect area, DisplayList const& fallback);
+	virtual void BeginLayer(LayerKey /*key*/, Rect /*area*/) {}
+	virtual void EndLayer() {}
+};
+
+// Defines DrawLayerOr, which replays a DisplayList; every renderer needs it.
+#include "DisplayList.h"
@@ -0,0 +1,75 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include "SlotMap.h"
+
+struct ResourceStats {
+	std::size_t creations{ 0 };
+	std::size_t losses{ 0 };
+	std::size_t live{ 0 };
+};
+
+// Hands out handles to resources that belong to a graphics device. Users keep
+// only the handle; the resource itself is created from its factory on first
+// use, and dropped for every handle at once when the device is lost, to be
+// created again the next time it is asked for.
+template<typename T>
+class ResourceRegistry {
+private:
+	struct Entry {
+		std::function<T()> create;
+		T resource{};
+		bool created{ false };
+	};
+
+	SlotMap<Entry> _entries;
+	ResourceStats _stats;
+
+public:
+	using Handle = SlotHandle;
+
+	Handle Register(std::function<T()>&& create) {
+		return _entries.Insert({ std::move(create) });
+	}
+
+	void Release(Handle handle) {
+		if (auto entry = _entries.Get(handle); entry && entry->created) {
+			--_stats.live;
+		}
+		_entries.Erase(handle);
+	}
+
+	// The resource for handle, created now if needed. Stays empty when the
+	// handle is stale or creation failed; creation is retried on the next call.
+	T const& Get(Handle handle) {
+		static T const none{};
+		auto entry = _entries.Get(handle);
+		if (!entry) {
+			return none;
+		}
+		if (!entry->created) {
+			entry->resource = entry->create();
+			entry->created = static_cast<bool>(entry->resource);
+			if (entry->created) {
+				++_stats.creations;
+				++_stats.live;
+			}
+		}
+		return entry->resource;
+	}
+
+	// Drops every created resource after the device went away. Handles stay
+	// valid.
+	void Lose() {
+		for (auto& entry : _entries) {
+			entry.resource = T{};
+			entry.created = false;
+		}
+		_stats.live = 0;
+		++_stats.losses;
+	}
+
+	ResourceStats Stats() const {
+		return _stats;
+	}
+};
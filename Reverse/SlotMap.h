@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+
+// A handle stays valid until the element it names is erased; after that the
+// slot's generation moves on and the old handle simply resolves to nothing.
+struct SlotHandle {
+	std::uint32_t index{ UINT32_MAX };
+	std::uint32_t generation{ 0 };
+
+	explicit operator bool() const { return index != UINT32_MAX; }
+	bool operator==(SlotHandle const&) const = default;
+};
+
+// Values are kept densely packed so iteration is a linear walk, while the
+// sparse slot table gives O(1) insertion, erasure and lookup by handle.
+// Erasure moves the last value into the hole, so element order is not stable.
+template<typename T>
+class SlotMap {
+private:
+	struct Slot {
+		std::uint32_t dense{ 0 };
+		std::uint32_t generation{ 0 };
+	};
+
+	std::vector<T> _values;
+	std::vector<std::uint32_t> _owners;
+	std::vector<Slot> _slots;
+	std::vector<std::uint32_t> _freeSlots;
+
+public:
+	SlotHandle Insert(T value) {
+		std::uint32_t index;
+		if (_freeSlots.empty()) {
+			index = static_cast<std::uint32_t>(_slots.size());
+			_slots.emplace_back();
+		} else {
+			index = _freeSlots.back();
+			_freeSlots.pop_back();
+		}
+		_slots[index].dense = static_cast<std::uint32_t>(_values.size());
+		_values.emplace_back(std::move(value));
+		_owners.emplace_back(index);
+		return { index, _slots[index].generation };
+	}
+
+	bool Erase(SlotHandle handle) {
+		if (!Contains(handle)) {
+			return false;
+		}
+		std::uint32_t dense = _slots[handle.index].dense;
+		std::uint32_t last = static_cast<std::uint32_t>(_values.size() - 1);
+		if (dense != last) {
+			_values[dense] = std::move(_values[last]);
+			_owners[dense] = _owners[last];
+			_slots[_owners[dense]].dense = dense;
+		}
+		_values.pop_back();
+		_owners.pop_back();
+		++_slots[handle.index].generation;
+		_freeSlots.emplace_back(handle.index);
+		return true;
+	}
+
+	bool Contains(SlotHandle handle) const {
+		return handle.index < _slots.size() && _slots[handle.index].generation == handle.generation;
+	}
+
+	T* Get(SlotHandle handle) {
+		return Contains(handle) ? &_values[_slots[handle.index].dense] : nullptr;
+	}
+	T const* Get(SlotHandle handle) const {
+		return Contains(handle) ? &_values[_slots[handle.index].dense] : nullptr;
+	}
+
+	// Handle of the value currently stored at dense position i.
+	SlotHandle HandleAt(std::size_t i) const {
+		return { _owners[i], _slots[_owners[i]].generation };
+	}
+
+	std::size_t Size() const { return _values.size(); }
+	bool Empty() const { return _values.empty(); }
+	T& operator[](std::size_t i) { return _values[i]; }
+	T const& operator[](std::size_t i) const { return _values[i]; }
+	auto begin() { return _values.begin(); }
+	auto end() { return _values.end(); }
+	auto begin() const { return _values.begin(); }
+	auto end() const { return _values.end(); }
+};
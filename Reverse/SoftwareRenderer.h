@@ -0,0 +1,287 @@
+#pragma once
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "Renderer.h"
+#include "TextLayoutCache.h"
+#include "GlyphAtlas.h"
+#include "LayerCache.h"
+
+// 32-bit 0xAARRGGBB pixels, row-major.
+struct Framebuffer {
+	int width{ 0 };
+	int height{ 0 };
+	std::vector<std::uint32_t> pixels;
+
+	void Resize(int w, int h) {
+		width = w;
+		height = h;
+		pixels.assign(static_cast<std::size_t>(w) * static_cast<std::size_t>(h), 0);
+	}
+
+	std::uint32_t At(int x, int y) const {
+		return pixels[static_cast<std::size_t>(y) * static_cast<std::size_t>(width) + static_cast<std::size_t>(x)];
+	}
+};
+
+inline std::uint32_t PackColor(Color color) {
+	auto channel = [](float value) {
+		return static_cast<std::uint32_t>(std::lround((std::clamp)(value, 0.f, 1.f) * 255.f));
+	};
+	return channel(color.a) << 24 | channel(color.r) << 16 | channel(color.g) << 8 | channel(color.b);
+}
+
+// Rasterizes into an in-memory framebuffer so frames can be rendered, timed
+// and compared without a window. Geometry is drawn aliased and snapped to
+// whole pixels. Text uses a synthetic fixed-pitch face with the same advance
+// and line height as the UI font: every glyph is a deterministic 5x7 pattern
+// derived from its code point, which is enough to measure text-heavy frames
+// and to spot layout changes in captured images. Glyphs are rasterized once
+// into a GlyphAtlas and blitted from it. Layers are framebuffers of their
+// own in which untouched pixels stay transparent.
+class SoftwareRenderer final : public Renderer {
+public:
+	static constexpr int glyphAdvance = 7;
+	static constexpr int lineHeight = 14;
+
+private:
+	struct PixelRect {
+		int left, top, right, bottom;
+	};
+
+	// Pen position relative to the text box, and the glyphs to draw.
+	struct PreparedText {
+		int x{ 0 };
+		int y{ 0 };
+		std::wstring glyphs;
+	};
+
+	// The layer being drawn, with what it replaced.
+	struct OpenLayer {
+		LayerKey key;
+		Framebuffer target;
+		std::vector<PixelRect> clips;
+		int originX;
+		int originY;
+	};
+
+	Framebuffer _target;
+	std::vector<PixelRect> _clips;
+	// Where _target's top-left pixel is; not zero while drawing a layer.
+	int _originX{ 0 };
+	int _originY{ 0 };
+	std::vector<OpenLayer> _openLayers;
+	LayerCache<Framebuffer> _layerCache;
+	TextLayoutCache<PreparedText> _layouts;
+	GlyphAtlas _atlas{ glyphAdvance, lineHeight, RasterizeGlyph };
+
+	static void RasterizeGlyph(wchar_t ch, std::uint8_t* coverage) {
+		std::fill_n(coverage, glyphAdvance * lineHeight, std::uint8_t{ 0 });
+		std::uint64_t pattern = GlyphPattern(ch);
+		for (int bit = 0; pattern; ++bit, pattern >>= 1) {
+			if (pattern & 1) {
+				coverage[(4 + bit / 5) * glyphAdvance + 1 + bit % 5] = 0xFF;
+			}
+		}
+	}
+
+	// Copies the covered pixels of one atlas cell to (x, y), inside the clip.
+	void Blit(std::uint8_t const* cell, int x, int y, std::uint32_t pixel) {
+		PixelRect r = Clipped({ x, y, x + glyphAdvance, y + lineHeight });
+		for (int py = r.top; py < r.bottom; ++py) {
+			std::uint8_t const* coverage = cell + (py - y) * glyphAdvance;
+			std::uint32_t* row = &_target.pixels[static_cast<std::size_t>(py) * static_cast<std::size_t>(_target.width)];
+			for (int px = r.left; px < r.right; ++px) {
+				if (coverage[px - x]) {
+					row[px] = pixel;
+				}
+			}
+		}
+	}
+
+	static PreparedText Prepare(Size size, std::wstring_view text) {
+		PreparedText prepared;
+		int width = static_cast<int>(text.size()) * glyphAdvance;
+		prepared.x = static_cast<int>(std::round((size.width - static_cast<float>(width)) / 2.f));
+		prepared.y = static_cast<int>(std::round((size.height - static_cast<float>(lineHeight)) / 2.f));
+		prepared.glyphs = text;
+		return prepared;
+	}
+
+	PixelRect Snap(Rect rect) const {
+		// Edges beyond the target are kept one pixel outside it, so a stroke
+		// along them is not pulled onto the visible border. Fill clips.
+		auto snap = [](float value, int limit) {
+			return static_cast<int>((std::clamp)(std::round(value), -1.f, static_cast<float>(limit + 1)));
+		};
+		float x = static_cast<float>(_originX), y = static_cast<float>(_originY);
+		return { snap(rect.left - x, _target.width), snap(rect.top - y, _target.height),
+			snap(rect.right - x, _target.width), snap(rect.bottom - y, _target.height) };
+	}
+
+	PixelRect Clipped(PixelRect rect) const {
+		PixelRect const& clip = _clips.back();
+		return { (std::max)(rect.left, clip.left), (std::max)(rect.top, clip.top),
+			(std::min)(rect.right, clip.right), (std::min)(rect.bottom, clip.bottom) };
+	}
+
+	static PixelRect Outer(Rect area) {
+		return { static_cast<int>(std::floor(area.left)), static_cast<int>(std::floor(area.top)),
+			static_cast<int>(std::ceil(area.right)), static_cast<int>(std::ceil(area.bottom)) };
+	}
+
+	void Fill(PixelRect rect, std::uint32_t pixel) {
+		rect = Clipped(rect);
+		for (int y = rect.top; y < rect.bottom; ++y) {
+			auto row = _target.pixels.begin() + static_cast<std::ptrdiff_t>(y) * _target.width;
+			std::fill(row + rect.left, row + (std::max)(rect.left, rect.right), pixel);
+		}
+	}
+
+public:
+	static std::uint64_t GlyphPattern(wchar_t ch) {
+		if (ch == L' ') {
+			return 0;
+		}
+		std::uint64_t h = static_cast<std::uint64_t>(ch) * 0x9E3779B97F4A7C15ull;
+		h ^= h >> 29;
+		// Always keep the bottom row so no visible glyph renders empty.
+		return (h & ((1ull << 30) - 1)) | (0x1Full << 30);
+	}
+
+	SoftwareRenderer(int width, int height) {
+		Resize(width, height);
+	}
+
+	void Resize(int width, int height) {
+		_target.Resize(width, height);
+		_clips.assign(1, { 0, 0, width, height });
+	}
+
+	Framebuffer const& Target() const {
+		return _target;
+	}
+
+	void Clear(Color color) override {
+		Fill({ 0, 0, _target.width, _target.height }, PackColor(color));
+	}
+
+	void FillRectangle(Rect rect, Brush brush) override {
+		Fill(Snap(rect), PackColor(BrushColor(brush)));
+	}
+
+	void FillSolid(Rect rect, Color color) override {
+		Fill(Snap(rect), PackColor(color));
+	}
+
+	void DrawRectangle(Rect rect, Brush brush) override {
+		PixelRect r = Snap(rect);
+		if (r.left >= r.right || r.top >= r.bottom) {
+			return;
+		}
+		std::uint32_t pixel = PackColor(BrushColor(brush));
+		Fill({ r.left, r.top, r.right, r.top + 1 }, pixel);
+		Fill({ r.left, r.bottom - 1, r.right, r.bottom }, pixel);
+		Fill({ r.left, r.top, r.left + 1, r.bottom }, pixel);
+		Fill({ r.right - 1, r.top, r.right, r.bottom }, pixel);
+	}
+
+	void DrawText(Rect rect, std::wstring_view text, Brush brush, TextKey key) override {
+		Size size{ rect.Width(), rect.Height() };
+		PreparedText uncached;
+		PreparedText const& prepared = key.owner
+			? _layouts.Get(key, size, 0, [&]() { return Prepare(size, text); })
+			: (uncached = Prepare(size, text));
+		std::uint32_t pixel = PackColor(BrushColor(brush));
+		int x = static_cast<int>(std::round(rect.left)) - _originX + prepared.x;
+		int y = static_cast<int>(std::round(rect.top)) - _originY + prepared.y;
+		for (wchar_t ch : prepared.glyphs) {
+			if (ch != L' ') {
+				Blit(_atlas.Cell(_atlas.Find(ch)), x, y, pixel);
+			}
+			x += glyphAdvance;
+		}
+	}
+
+	// Call once per frame, after the last draw.
+	void EndFrame(std::size_t textLayoutCapacity = 1024) {
+		_layouts.EndFrame(textLayoutCapacity);
+	}
+
+	TextLayoutStats TextLayouts() const {
+		return _layouts.Stats();
+	}
+
+	GlyphAtlasStats Glyphs() const {
+		return _atlas.Stats();
+	}
+
+	LayerStats Layers() const {
+		return _layerCache.Stats();
+	}
+
+	bool CanLayer(Rect area) const override {
+		PixelRect r = Outer(area);
+		std::size_t bytes = static_cast<std::size_t>((std::max)(r.right - r.left, 0)) * static_cast<std::size_t>((std::max)(r.bottom - r.top, 0)) * 4;
+		return bytes && bytes <= _layerCache.Budget();
+	}
+
+	bool HasLayer(LayerKey key) const override {
+		return _layerCache.Contains(key);
+	}
+
+	bool DrawLayer(LayerKey key, Rect area) override {
+		Framebuffer const* layer = _layerCache.Find(key);
+		if (!layer) {
+			return false;
+		}
+		PixelRect outer = Outer(area);
+		int x = outer.left - _originX, y = outer.top - _originY;
+		PixelRect r = Clipped({ x, y, x + layer->width, y + layer->height });
+		for (int py = r.top; py < r.bottom; ++py) {
+			std::uint32_t* row = &_target.pixels[static_cast<std::size_t>(py) * static_cast<std::size_t>(_target.width)];
+			for (int px = r.left; px < r.right; ++px) {
+				std::uint32_t pixel = layer->At(px - x, py - y);
+				if (pixel >> 24) {
+					row[px] = pixel;
+				}
+			}
+		}
+		return true;
+	}
+
+	void BeginLayer(LayerKey key, Rect area) override {
+		PixelRect outer = Outer(area);
+		_openLayers.push_back({ key, std::move(_target), std::move(_clips), _originX, _originY });
+		_target = {};
+		_target.Resize(outer.right - outer.left, outer.bottom - outer.top);
+		_clips.assign(1, { 0, 0, _target.width, _target.height });
+		_originX = outer.left;
+		_originY = outer.top;
+	}
+
+	void EndLayer() override {
+		if (_openLayers.empty()) {
+			return;
+		}
+		OpenLayer& open = _openLayers.back();
+		std::size_t bytes = _target.pixels.size() * sizeof(std::uint32_t);
+		_layerCache.Store(open.key, std::move(_target), bytes);
+		_target = std::move(open.target);
+		_clips = std::move(open.clips);
+		_originX = open.originX;
+		_originY = open.originY;
+		_openLayers.pop_back();
+	}
+
+	void PushClip(Rect rect) override {
+		_clips.emplace_back(Clipped(Snap(rect)));
+	}
+
+	void PopClip() override {
+		if (_clips.size() > 1) {
+			_clips.pop_back();
+		}
+	}
+};
@@ -0,0 +1,105 @@
+#pragma once
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include "Geometry.h"
+
+// Buckets values by the square cells their rectangles touch, so the values
+// near a region are found without looking at the rest. Each value carries an
+// order, and queries return values in that order. Rectangles spanning too
+// many cells, unbounded ones included, are kept aside and always returned.
+template<typename T>
+class SpatialGrid {
+private:
+	struct Entry {
+		std::size_t order;
+		T value;
+	};
+
+	static constexpr long long maxCells = 1024;
+
+	float _cellSize;
+	std::unordered_map<std::uint64_t, std::vector<Entry>> _cells;
+	std::vector<Entry> _everywhere;
+	std::vector<Entry> _found;
+
+	struct CellRange {
+		long long left, top, right, bottom;
+
+		long long Count() const {
+			return (right - left + 1) * (bottom - top + 1);
+		}
+	};
+
+	// False when the rectangle spans too many cells to enumerate.
+	bool Cells(Rect rect, CellRange& range) const {
+		constexpr float limit = 1e9f;
+		if (!(rect.left > -limit && rect.top > -limit && rect.right < limit && rect.bottom < limit)) {
+			return false;
+		}
+		range = {
+			static_cast<long long>(std::floor(rect.left / _cellSize)), static_cast<long long>(std::floor(rect.top / _cellSize)),
+			static_cast<long long>(std::floor(rect.right / _cellSize)), static_cast<long long>(std::floor(rect.bottom / _cellSize))
+		};
+		return range.Count() <= maxCells;
+	}
+
+	static std::uint64_t Key(long long x, long long y) {
+		return static_cast<std::uint64_t>(static_cast<std::uint32_t>(x)) << 32 | static_cast<std::uint32_t>(y);
+	}
+
+public:
+	explicit SpatialGrid(float cellSize = 128.f) : _cellSize{ cellSize } {}
+
+	void Clear() {
+		// Cells keep their storage for the next rebuild.
+		for (auto& [key, entries] : _cells) {
+			entries.clear();
+		}
+		_everywhere.clear();
+	}
+
+	void Insert(Rect rect, T value, std::size_t order) {
+		if (RectangleIsEmpty(rect)) {
+			return;
+		}
+		CellRange range;
+		if (!Cells(rect, range)) {
+			_everywhere.push_back({ order, value });
+			return;
+		}
+		for (long long y = range.top; y <= range.bottom; ++y) {
+			for (long long x = range.left; x <= range.right; ++x) {
+				_cells[Key(x, y)].push_back({ order, value });
+			}
+		}
+	}
+
+	// Calls f, in order, on every value whose rectangle may intersect region.
+	// Returns false, calling nothing, when region is too large to look up;
+	// the caller should then walk everything itself.
+	template<typename F>
+	bool Query(Rect region, F&& f) {
+		CellRange range;
+		if (!Cells(region, range)) {
+			return false;
+		}
+		_found.assign(_everywhere.begin(), _everywhere.end());
+		for (long long y = range.top; y <= range.bottom; ++y) {
+			for (long long x = range.left; x <= range.right; ++x) {
+				if (auto cell = _cells.find(Key(x, y)); cell != _cells.end()) {
+					_found.insert(_found.end(), cell->second.begin(), cell->second.end());
+				}
+			}
+		}
+		std::sort(_found.begin(), _found.end(), [](Entry const& a, Entry const& b) { return a.order < b.order; });
+		auto last = std::unique(_found.begin(), _found.end(), [](Entry const& a, Entry const& b) { return a.order == b.order; });
+		for (auto it = _found.begin(); it != last; ++it) {
+			f(it->value);
+		}
+		return true;
+	}
+};
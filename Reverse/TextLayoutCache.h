@@ -0,0 +1,78 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include "Renderer.h"
+
+struct TextLayoutStats {
+	std::size_t hits{ 0 };
+	std::size_t misses{ 0 };
+	std::size_t entries{ 0 };
+};
+
+// Keeps one prepared layout per text item, so text that has not changed is
+// not shaped again every frame. An entry is reused while the item's text
+// version, box size and format all match; any change rebuilds it in place.
+template<typename Layout>
+class TextLayoutCache {
+private:
+	struct Key {
+		std::uint64_t owner;
+		std::uint64_t item;
+		bool operator==(Key const&) const = default;
+	};
+	struct KeyHash {
+		std::size_t operator()(Key const& key) const {
+			return std::hash<std::uint64_t>{}(key.owner * 0x9E3779B97F4A7C15ull ^ key.item);
+		}
+	};
+	struct Entry {
+		std::uint32_t version;
+		std::uint32_t format;
+		Size size;
+		std::uint64_t lastFrame;
+		Layout layout;
+	};
+
+	std::unordered_map<Key, Entry, KeyHash> _entries;
+	std::uint64_t _frame{ 0 };
+	std::size_t _hits{ 0 };
+	std::size_t _misses{ 0 };
+
+public:
+	// Returns the cached layout for key, calling create() to build it when
+	// there is none or it is out of date.
+	template<typename Create>
+	Layout& Get(TextKey key, Size size, std::uint32_t format, Create&& create) {
+		auto [it, inserted] = _entries.try_emplace(Key{ key.owner, key.item });
+		Entry& entry = it->second;
+		if (!inserted && entry.version == key.version && entry.format == format && entry.size == size) {
+			++_hits;
+		} else {
+			++_misses;
+			entry.version = key.version;
+			entry.format = format;
+			entry.size = size;
+			entry.layout = create();
+		}
+		entry.lastFrame = _frame;
+		return entry.layout;
+	}
+
+	// Ends a frame. Once the cache holds more than capacity entries, the ones
+	// not used in this frame are dropped.
+	void EndFrame(std::size_t capacity) {
+		if (_entries.size() > capacity) {
+			std::erase_if(_entries, [this](auto const& entry) { return entry.second.lastFrame != _frame; });
+		}
+		++_frame;
+	}
+
+	void Clear() {
+		_entries.clear();
+	}
+
+	TextLayoutStats Stats() const {
+		return { _hits, _misses, _entries.size() };
+	}
+};
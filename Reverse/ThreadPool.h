@@ -0,0 +1,112 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A fixed set of worker threads for data-parallel loops. ParallelFor hands
+// out indices in small chunks to the workers and to the calling thread, and
+// returns once every index has been processed. Calls must not overlap.
+class ThreadPool {
+private:
+	static constexpr std::size_t grain = 8;
+
+	std::vector<std::thread> _workers;
+	std::mutex _mutex;
+	std::condition_variable _wake;
+	std::condition_variable _done;
+	std::function<void(std::size_t)> const* _job{ nullptr };
+	std::size_t _count{ 0 };
+	std::atomic<std::size_t> _next{ 0 };
+	std::size_t _busy{ 0 };
+	std::uint64_t _generation{ 0 };
+	bool _stopping{ false };
+
+	void Drain(std::function<void(std::size_t)> const& job, std::size_t count) {
+		for (;;) {
+			std::size_t begin = _next.fetch_add(grain, std::memory_order_relaxed);
+			if (begin >= count) {
+				return;
+			}
+			std::size_t end = (std::min)(begin + grain, count);
+			for (std::size_t i = begin; i < end; ++i) {
+				job(i);
+			}
+		}
+	}
+
+	void Work() {
+		std::uint64_t seen = 0;
+		std::unique_lock lock{ _mutex };
+		for (;;) {
+			_wake.wait(lock, [&]() { return _stopping || _generation != seen; });
+			if (_stopping) {
+				return;
+			}
+			seen = _generation;
+			auto job = _job;
+			auto count = _count;
+			lock.unlock();
+			Drain(*job, count);
+			lock.lock();
+			if (--_busy == 0) {
+				_done.notify_one();
+			}
+		}
+	}
+
+public:
+	// threads counts the caller; one means everything runs inline.
+	explicit ThreadPool(std::size_t threads = std::thread::hardware_concurrency()) {
+		for (std::size_t i = 1; i < threads; ++i) {
+			_workers.emplace_back([this]() { Work(); });
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard lock{ _mutex };
+			_stopping = true;
+		}
+		_wake.notify_all();
+		for (auto& worker : _workers) {
+			worker.join();
+		}
+	}
+
+	ThreadPool(ThreadPool const&) = delete;
+	ThreadPool& operator=(ThreadPool const&) = delete;
+
+	std::size_t Threads() const {
+		return _workers.size() + 1;
+	}
+
+	template<typename F>
+	void ParallelFor(std::size_t count, F&& f) {
+		if (_workers.empty() || count <= grain) {
+			for (std::size_t i = 0; i < count; ++i) {
+				f(i);
+			}
+			return;
+		}
+		std::function<void(std::size_t)> job{ std::ref(f) };
+		{
+			std::lock_guard lock{ _mutex };
+			_job = &job;
+			_count = count;
+			_next.store(0, std::memory_order_relaxed);
+			_busy = _workers.size();
+			++_generation;
+		}
+		_wake.notify_all();
+		Drain(job, count);
+		std::unique_lock lock{ _mutex };
+		_done.wait(lock, [&]() { return _busy == 0; });
+		_job = nullptr;
+	}
+};
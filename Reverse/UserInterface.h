@@ -0,0 +1,49 @@
+#pragma once
+#include <algorithm>
+#include <string>
+#include "Layout.h"
+#include "Controls.h"
+
+struct UserInterfaceHandles {
+	ControlHandle input;
+	ControlHandle output;
+	ControlHandle numbers;
+};
+
+// Builds the demo UI: a text box whose text appears reversed in a label, and
+// a list of a million reversed numbers. The controls are laid out by
+// layoutRoot.
+inline UserInterfaceHandles UserInterface(LayoutNode& layoutRoot) {
+	TextBox* input = new TextBox{ { 20.f, 20.f, 150.f, 50.f } };
+	Label* output = new Label{ { 20.f, 60.f, 150.f, 85.f } };
+	layoutRoot.SetPadding(20.f).SetGap(10.f);
+	layoutRoot.Append(Arrange(input->Handle())).SetSize({ 130.f, 30.f });
+	layoutRoot.Append(Arrange(output->Handle())).SetSize({ 130.f, 25.f });
+
+	ListView* numbers = new ListView{ { 20.f, 95.f, 150.f, 400.f } };
+	numbers->SetItems(1'000'000, [](std::size_t i) {
+		auto text{ std::to_wstring(i) };
+		std::reverse(text.begin(), text.end());
+		return text;
+	});
+	layoutRoot.Append(Arrange(numbers->Handle())).SetSize({ 130.f, LayoutNode::automatic }).SetGrow(1.f);
+	// Reversed in the background; typing on cancels a reversal in flight.
+	input->WhenChangeAsync([inputHandle = input->Handle()]() {
+		auto input = ControlContainer::GetInstance().Get<TextBox>(inputHandle);
+		return input ? input->Text() : std::wstring{};
+	}, [](std::wstring text, CancellationToken const& token) {
+		constexpr std::size_t chunk = 1 << 16;
+		std::wstring reversed;
+		reversed.reserve(text.size());
+		for (std::size_t done = 0; done < text.size() && !token.Cancelled(); done += chunk) {
+			auto from = text.rbegin() + static_cast<std::ptrdiff_t>(done);
+			reversed.append(from, from + static_cast<std::ptrdiff_t>((std::min)(chunk, text.size() - done)));
+		}
+		return reversed;
+	}, [outputHandle = output->Handle()](std::wstring reversed) {
+		if (auto output = ControlContainer::GetInstance().Get<Label>(outputHandle)) {
+			output->Text(std::move(reversed));
+		}
+	});
+	return { input->Handle(), output->Handle(), numbers->Handle() };
+}
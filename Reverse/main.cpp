@@ -7,17 +7,58 @@
 #include <algorithm>
 #include <functional>
 #include <stdexcept>
+#include <chrono>
+#include <string>
+#include <array>
+#include <cmath>
+#include <optional>
+#include <filesystem>
+#include <fstream>
+
+#undef SendMessage
+#undef GetMessage
+
+#include "Layout.h"
+#include "Controls.h"
+#include "TextLayoutCache.h"
+#include "Compositor.h"
+#include "ResourceRegistry.h"
+#include "FrameScheduler.h"
+#include "LayerCache.h"
+#include "Application.h"
+#include "ThreadPool.h"
+#include "HeadlessDriver.h"
+#include "InputRecording.h"
+#include "Executor.h"
 
 HWND hwnd;
 CComPtr<ID2D1Factory> factory{};
 CComPtr<ID2D1HwndRenderTarget> renderTarget{};
-CComPtr<ID2D1SolidColorBrush> buttonBorderBrush{}, buttonNormalBrush{}, buttonHoverBrush{}, textBoxBorderBrush{}, textWriteBrush{};
+// Everything created from renderTarget. Controls never see these, so they
+// can be thrown away and recreated when the target is.
+ResourceRegistry<CComPtr<ID2D1SolidColorBrush>> deviceResources;
+std::array<SlotHandle, brushCount> brushHandles;
+// Recoloured before every FillSolid.
+SlotHandle solidBrushHandle;
+// Bitmaps of static controls, device-dependent as well.
+LayerCache<CComPtr<ID2D1Bitmap>> layerCache{ 16u << 20 };
+
+// While the window edge is dragged, frames only show the last full frame,
+// cropped to the new size; layout and a full paint wait for the drag to end.
+bool liveResize = false;
+CComPtr<ID2D1Bitmap> resizePreview;
+D2D1_SIZE_U pendingSize{};
+bool sizePending = false;
+// Between WM_ENTERSIZEMOVE and WM_EXITSIZEMOVE. A plain move is bracketed the
+// same way, so live resize only starts once a WM_SIZE changes the size.
+bool sizeMove = false;
+
+D2D1_RECT_F ToD2D(Rect rect) {
+	return D2D1::RectF(rect.left, rect.top, rect.right, rect.bottom);
+}
 
-bool PointInRectangle(D2D1_RECT_F rectangle, D2D1_POINT_2U point) {
-	return rectangle.top < point.y
-		&& rectangle.bottom > point.y
-		&& rectangle.left < point.x
-		&& rectangle.right > point.x;
+D2D1_COLOR_F ToD2D(Color color) {
+	return D2D1::ColorF(color.r, color.g, color.b, color.a);
 }
 
 class TextWriter {
@@ -27,13 +68,39 @@ public:
 		return textWriter;
 	}
 
-	void Draw(D2D1_RECT_F area, std::wstring_view text) {
-		renderTarget->DrawTextW(text.data(), static_cast<unsigned>(text.size()), _textFormat, &area, textWriteBrush);
+	void Draw(ID2D1RenderTarget* target, D2D1_RECT_F area, std::wstring_view text, ID2D1Brush* brush) {
+		target->DrawTextW(text.data(), static_cast<unsigned>(text.size()), _textFormat, &area, brush);
+	}
+
+	// Draws through a cached IDWriteTextLayout so unchanged text is not shaped
+	// again. Falls back to DrawTextW when the key opts out or layout fails.
+	void Draw(ID2D1RenderTarget* target, D2D1_RECT_F area, std::wstring_view text, ID2D1Brush* brush, TextKey key) {
+		if (key.owner == 0) {
+			Draw(target, area, text, brush);
+			return;
+		}
+		Size size{ area.right - area.left, area.bottom - area.top };
+		auto& layout = _layouts.Get(key, size, 0, [&]() {
+			CComPtr<IDWriteTextLayout> created;
+			_directWriteFactory->CreateTextLayout(text.data(), static_cast<unsigned>(text.size()), _textFormat,
+				size.width, size.height, &created);
+			return created;
+		});
+		if (!layout) {
+			Draw(target, area, text, brush);
+			return;
+		}
+		target->DrawTextLayout(D2D1::Point2F(area.left, area.top), layout, brush);
+	}
+
+	TextLayoutCache<CComPtr<IDWriteTextLayout>>& Layouts() {
+		return _layouts;
 	}
 
 private:
 	CComPtr<IDWriteFactory> _directWriteFactory;
 	CComPtr<IDWriteTextFormat> _textFormat;
+	TextLayoutCache<CComPtr<IDWriteTextLayout>> _layouts;
 
 	TextWriter() {
 		HRESULT hr = DWriteCreateFactory(
@@ -64,270 +131,545 @@ private:
 	}
 };
 
-#undef SendMessage
-#undef GetMessage
-
-class Control {
-protected:
-	D2D1_RECT_F _area;
-	bool _onHover{ false };
-	bool _onClick{ false };
-	bool _onFocus{ false };
-	std::function<void()> _clickEvent{ []() {} };
-	std::function<void()> _changeEvent{ []() {} };
-public:
-	Control(D2D1_RECT_F area);
-	virtual ~Control();
-
-	virtual void Show();
-	virtual void Paint();
-	virtual void OnHover(D2D1_POINT_2U point);
-	virtual void OnClick(D2D1_POINT_2U click);
-	virtual void OnFocus();
-	virtual void OnKeyDown(unsigned key);
-	virtual void OnChar(wchar_t ch);
-	virtual void LeaveClick();
-	virtual void LeaveHover();
-	virtual void LeaveFocus();
-	bool IsHover() const;
-	bool IsClicked() const;
-	bool IsFocused() const;
-	void WhenClick(std::function<void()>&& f);
-	void WhenChange(std::function<void()>&& f);
-	template<typename T>
-	void SendMessage(T* to) {
-		to->GetMessage(this);
-	}
-	template<typename T, typename U>
-	void SendMessage(T* to, U* data) {
-		to->GetMessage(this, data);
-	}
-	D2D1_RECT_F const& Area() const;
-};
-
-class ControlContainer {
+// Renders onto the window's Direct2D render target, or onto a layer bitmap
+// created from it while one is open.
+class Direct2DRenderer final : public Renderer {
 private:
-	ControlContainer() {}
-	~ControlContainer() {
-		for (auto control : _controls) {
-			delete control;
-		}
+	struct OpenLayer {
+		LayerKey key;
+		CComPtr<ID2D1BitmapRenderTarget> target;
+		ID2D1RenderTarget* previous;
+	};
+
+	ID2D1RenderTarget* _target{ renderTarget };
+	std::vector<OpenLayer> _openLayers;
+
+	// Null if the brush could not be created; the draw is then skipped.
+	static ID2D1SolidColorBrush* Resolve(Brush brush) {
+		return deviceResources.Get(brushHandles[static_cast<std::size_t>(brush)]);
+	}
+
+	// DrawRectangle's one-pixel stroke straddles the outline, as the
+	// compositor's bounds assume, so a layer keeps the outer half of a
+	// control's border as well.
+	static constexpr float strokeOutset = 1.f;
+
+	// The pixels a layer of area covers; CanLayer, BeginLayer and DrawLayer
+	// must agree on it.
+	static D2D1_RECT_U Outer(Rect area) {
+		auto edge = [](float value) { return static_cast<UINT32>((std::max)(value, 0.f)); };
+		return D2D1::RectU(edge(std::floor(area.left - strokeOutset)), edge(std::floor(area.top - strokeOutset)),
+			edge(std::ceil(area.right + strokeOutset)), edge(std::ceil(area.bottom + strokeOutset)));
 	}
-	std::vector<Control*> _controls;
 public:
-	void Add(Control* control) {
-		_controls.emplace_back(control);
-	}
-
-	void OnHover(unsigned x, unsigned y) {
-		for (auto control : _controls) {
-			if (PointInRectangle(control->Area(), { x, y })) {
-				if (!control->IsHover()) {
-					control->OnHover({ x, y });
-				}
-			} else if (control->IsHover()) {
-				control->LeaveHover();
-			}
+	void Clear(Color color) override {
+		_target->Clear(ToD2D(color));
+	}
+	void FillRectangle(Rect rect, Brush brush) override {
+		if (auto resolved = Resolve(brush)) {
+			_target->FillRectangle(ToD2D(rect), resolved);
 		}
 	}
-
-	void OnClick(unsigned x, unsigned y) {
-		for (auto control : _controls) {
-			if (PointInRectangle(control->Area(), { x, y })) {
-				control->OnClick({ x, y });
-				control->OnFocus();
-			} else if (control->IsFocused()) {
-				control->LeaveFocus();
-			}
+	void FillSolid(Rect rect, Color color) override {
+		if (ID2D1SolidColorBrush* brush = deviceResources.Get(solidBrushHandle)) {
+			brush->SetColor(ToD2D(color));
+			_target->FillRectangle(ToD2D(rect), brush);
 		}
 	}
-	void OnChar(WPARAM ch) {
-		for (auto control : _controls) {
-			if (control->IsFocused()) {
-				control->OnChar(static_cast<wchar_t>(ch));
-				break;
-			}
+	void DrawRectangle(Rect rect, Brush brush) override {
+		if (auto resolved = Resolve(brush)) {
+			_target->DrawRectangle(ToD2D(rect), resolved);
 		}
 	}
-	void OnKeyDown(WPARAM key) {
-		for (auto control : _controls) {
-			if (control->IsFocused()) {
-				control->OnKeyDown(static_cast<unsigned>(key));
-				break;
-			}
+	void FillRectangles(std::span<Rect const> rects, Brush brush) override {
+		auto resolved = Resolve(brush);
+		if (!resolved) {
+			return;
+		}
+		for (auto const& rect : rects) {
+			_target->FillRectangle(ToD2D(rect), resolved);
 		}
 	}
-	
-	void LeaveClick() {
-		for (auto control : _controls) {
-			if (control->IsClicked()) {
-				control->LeaveClick();
-			}
+	void DrawRectangles(std::span<Rect const> rects, Brush brush) override {
+		auto resolved = Resolve(brush);
+		if (!resolved) {
+			return;
+		}
+		for (auto const& rect : rects) {
+			_target->DrawRectangle(ToD2D(rect), resolved);
 		}
 	}
-
-	void Paint() {
-		for (auto control : _controls) {
-			control->Paint();
+	void DrawText(Rect rect, std::wstring_view text, Brush brush, TextKey key) override {
+		if (auto resolved = Resolve(brush)) {
+			TextWriter::GetInstance().Draw(_target, ToD2D(rect), text, resolved, key);
 		}
 	}
-
-	static ControlContainer& GetInstance() {
-		static ControlContainer instance;
-		return instance;
+	void PushClip(Rect rect) override {
+		_target->PushAxisAlignedClip(ToD2D(rect), D2D1_ANTIALIAS_MODE_ALIASED);
 	}
-};
-
-Control::Control(D2D1_RECT_F area)
-	: _area(area) {
-	ControlContainer::GetInstance().Add(this);
-}
-Control::~Control() {}
-void Control::Show() {}
-void Control::Paint() {}
-void Control::OnHover(D2D1_POINT_2U point) { _onHover = true; }
-void Control::OnClick(D2D1_POINT_2U click) { _onClick = true; }
-void Control::OnFocus() { _onFocus = true; }
-void Control::OnKeyDown(unsigned key) {}
-void Control::OnChar(wchar_t ch) {}
-void Control::LeaveClick() { _onClick = false; _clickEvent(); }
-void Control::LeaveHover() { _onHover = false; }
-void Control::LeaveFocus() { _onFocus = false; }
-bool Control::IsHover() const { return _onHover; }
-bool Control::IsClicked() const { return _onClick; }
-bool Control::IsFocused() const { return _onFocus; }
-void Control::WhenClick(std::function<void()>&& f) { _clickEvent = std::forward<std::function<void()>>(f); }
-void Control::WhenChange(std::function<void()>&& f) { _changeEvent = std::forward<std::function<void()>>(f); }
-D2D1_RECT_F const& Control::Area() const { return _area; }
-
-class Label : public Control {
-private:
-	std::wstring _text{};
-public:
-	using Control::Control;
-
-	Label(D2D1_RECT_F area, std::wstring text)
-		: Control(area), _text(text)
-	{}
-
-	void Paint() override {
-		TextWriter::GetInstance().Draw(_area, _text);
+	void PopClip() override {
+		_target->PopAxisAlignedClip();
 	}
 
-	void Text(std::wstring text) {
-		_text = text;
+	bool CanLayer(Rect area) const override {
+		auto outer = Outer(area);
+		std::size_t bytes = static_cast<std::size_t>(outer.right - outer.left) * (outer.bottom - outer.top) * 4;
+		return bytes && bytes <= layerCache.Budget();
 	}
-};
-
-class TextBox : public Control {
-private:
-	std::wstring _text;
-public:
-	using Control::Control;
-
-	void Paint() override{
-		renderTarget->DrawRectangle(_area, textBoxBorderBrush);
-		TextWriter::GetInstance().Draw(_area, _text);
+	bool HasLayer(LayerKey key) const override {
+		return layerCache.Contains(key);
 	}
-	void OnChar(wchar_t ch) override {
-		if (ch != '\b') {
-			_text += ch;
-			_changeEvent();
+	bool DrawLayer(LayerKey key, Rect area) override {
+		auto layer = layerCache.Find(key);
+		if (!layer) {
+			return false;
 		}
+		auto outer = Outer(area);
+		_target->DrawBitmap(*layer,
+			D2D1::RectF(static_cast<float>(outer.left), static_cast<float>(outer.top), static_cast<float>(outer.right), static_cast<float>(outer.bottom)),
+			1.f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+		return true;
 	}
-	void OnKeyDown(unsigned key) override {
-		if (key == VK_BACK && !_text.empty()) {
-			_text.pop_back();
-			_changeEvent();
+	// Layer bitmaps share resources with the window target, so the same
+	// brushes draw on them. If one cannot be created, drawing stays where it
+	// was and nothing is kept.
+	void BeginLayer(LayerKey key, Rect area) override {
+		auto outer = Outer(area);
+		CComPtr<ID2D1BitmapRenderTarget> layer;
+		HRESULT hr = renderTarget->CreateCompatibleRenderTarget(
+			D2D1::SizeF(static_cast<float>(outer.right - outer.left), static_cast<float>(outer.bottom - outer.top)), &layer);
+		if (SUCCEEDED(hr)) {
+			layer->BeginDraw();
+			layer->Clear(D2D1::ColorF(0, 0.f));
+			layer->SetTransform(D2D1::Matrix3x2F::Translation(-static_cast<float>(outer.left), -static_cast<float>(outer.top)));
+			// ClearType needs an opaque background.
+			layer->SetTextAntialiasMode(D2D1_TEXT_ANTIALIAS_MODE_GRAYSCALE);
+		}
+		_openLayers.push_back({ key, layer, _target });
+		if (layer) {
+			_target = layer;
 		}
 	}
-	std::wstring Text() const {
-		return _text;
+	void EndLayer() override {
+		if (_openLayers.empty()) {
+			return;
+		}
+		OpenLayer open = std::move(_openLayers.back());
+		_openLayers.pop_back();
+		_target = open.previous;
+		if (!open.target || FAILED(open.target->EndDraw())) {
+			return;
+		}
+		CComPtr<ID2D1Bitmap> bitmap;
+		if (SUCCEEDED(open.target->GetBitmap(&bitmap))) {
+			auto size = bitmap->GetPixelSize();
+			layerCache.Store(open.key, bitmap, static_cast<std::size_t>(size.width) * size.height * 4);
+		}
 	}
 };
 
-class Button : public Control {
-private:
-	ID2D1SolidColorBrush* GetBrush() {
-		return _onHover ? buttonHoverBrush : buttonNormalBrush;
-	}
-public:
-	using Control::Control;
+// Built once the window exists, as WM_SIZE arrives before that, and reset
+// before WinMain returns.
+std::optional<Application> application;
+// Set by "--record-input <file>"; saved when the window is destroyed.
+std::optional<InputRecorder> inputRecorder;
+std::filesystem::path inputRecordingPath;
 
-	void Paint() override {
-		renderTarget->FillRectangle(_area, GetBrush());
+void RegisterBrushes()
+{
+	for (std::size_t i = 0; i < brushCount; ++i) {
+		brushHandles[i] = deviceResources.Register([color = BrushColor(static_cast<Brush>(i))]() {
+			CComPtr<ID2D1SolidColorBrush> brush;
+			renderTarget->CreateSolidColorBrush(ToD2D(color), &brush);
+			return brush;
+		});
 	}
-};
-
-void UserInterface() {
-	TextBox* input = new TextBox{ D2D1::RectF(20.f, 20.f, 150.f, 50.f) };
-	Label* output = new Label{ D2D1::RectF(20.f, 60.f, 150.f, 85.f) };
-	input->WhenChange([=]() {
-		auto text{ input->Text() };
-		std::reverse(text.begin(), text.end());
-		output->Text(text);
+	solidBrushHandle = deviceResources.Register([]() {
+		CComPtr<ID2D1SolidColorBrush> brush;
+		renderTarget->CreateSolidColorBrush(ToD2D(backgroundColor), &brush);
+		return brush;
 	});
 }
 
-void CreateD2DResource(HWND hWnd)
+// Called once at startup and again whenever the device is lost. Resources in
+// deviceResources follow lazily on their next use.
+bool CreateRenderTarget(HWND hWnd)
 {
-	if (!renderTarget)
-	{
-		HRESULT hr;
+	HRESULT hr;
 
+	if (!factory)
+	{
 		hr = D2D1CreateFactory(D2D1_FACTORY_TYPE_SINGLE_THREADED, &factory);
 		if (FAILED(hr))
 		{
 			MessageBoxW(hWnd, L"Create D2D factory failed!", L"Error", 0);
-			return;
+			return false;
 		}
+	}
 
-		// Obtain the size of the drawing area
-		RECT rc;
-		GetClientRect(hWnd, &rc);
-
-		// Create a Direct2D render target
-		hr = factory->CreateHwndRenderTarget(
-			D2D1::RenderTargetProperties(),
-			D2D1::HwndRenderTargetProperties(
-				hWnd,
-				D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top)
-			),
-			&renderTarget
-		);
-		if (FAILED(hr))
-		{
-			MessageBoxW(hWnd, L"Create render target failed!", L"Error", 0);
-			return;
-		}
+	// Obtain the size of the drawing area
+	RECT rc;
+	GetClientRect(hWnd, &rc);
+
+	// Create a Direct2D render target
+	hr = factory->CreateHwndRenderTarget(
+		D2D1::RenderTargetProperties(),
+		D2D1::HwndRenderTargetProperties(
+			hWnd,
+			D2D1::SizeU(rc.right - rc.left, rc.bottom - rc.top),
+			// Partial repaints draw on top of the previous frame
+			D2D1_PRESENT_OPTIONS_RETAIN_CONTENTS
+		),
+		&renderTarget
+	);
+	if (FAILED(hr))
+	{
+		MessageBoxW(hWnd, L"Create render target failed!", L"Error", 0);
+		return false;
+	}
+	return true;
+}
 
-		// Create a brush
-		hr = renderTarget->CreateSolidColorBrush(D2D1::ColorF(0xF7F7F7, 1.f), &buttonNormalBrush)
-			| renderTarget->CreateSolidColorBrush(D2D1::ColorF(0xEAEAEA), &buttonHoverBrush)
-			| renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Black), &textWriteBrush)
-			| renderTarget->CreateSolidColorBrush(D2D1::ColorF(D2D1::ColorF::Gray), &textBoxBorderBrush);
-		if (FAILED(hr))
-		{
-			MessageBoxW(hWnd, L"Create brush failed!", L"Error", 0);
-			return;
-		}
+// The old target's contents are gone, so the whole window is painted again.
+// Text layouts do not depend on the device and are kept.
+void RecoverDeviceLoss(HWND hWnd)
+{
+	renderTarget.Release();
+	deviceResources.Lose();
+	layerCache.Clear();
+	resizePreview.Release();
+	sizePending = false;
+	if (!CreateRenderTarget(hWnd)) {
+		DestroyWindow(hWnd);
+		return;
 	}
+	InvalidateRect(hWnd, nullptr, FALSE);
 }
 
+// Layouts kept alive across frames before unused ones are dropped.
+constexpr std::size_t textLayoutCapacity = 1024;
+
+// Reused every frame so its batches keep their storage. No glyph of the
+// fixed-pitch UI font is wider than its 14 DIP em.
+Compositor compositor{ 14.f };
+
 VOID DrawRectangle(HWND hwnd)
 {
-	CreateD2DResource(hwnd);
+	// The update rectangle also covers areas Windows invalidated by itself,
+	// e.g. when part of the window is uncovered.
+	RECT update{};
+	GetUpdateRect(hwnd, &update, FALSE);
+	auto& controls = ControlContainer::GetInstance();
+	Rect region = UnionRectangle(controls.TakeDirty(), {
+		static_cast<float>(update.left), static_cast<float>(update.top),
+		static_cast<float>(update.right), static_cast<float>(update.bottom) });
+	ValidateRect(hwnd, nullptr);
+	if (RectangleIsEmpty(region)) {
+		return;
+	}
 
+	Direct2DRenderer renderer;
 	renderTarget->BeginDraw();
-	renderTarget->Clear(D2D1::ColorF(D2D1::ColorF::White));
-	ControlContainer::GetInstance().Paint();
+	renderer.PushClip(region);
+	renderer.Clear(backgroundColor);
+	compositor.SetBackend(&renderer);
+	controls.Paint(compositor, region);
+	compositor.Flush(renderer);
+	compositor.SetBackend(nullptr);
+	renderer.PopClip();
+	TextWriter::GetInstance().Layouts().EndFrame(textLayoutCapacity);
 
 	HRESULT hr = renderTarget->EndDraw();
+	if (hr == D2DERR_RECREATE_TARGET)
+	{
+		RecoverDeviceLoss(hwnd);
+		return;
+	}
 	if (FAILED(hr))
 	{
 		MessageBoxW(nullptr, L"Draw failed!", L"Error", MB_OK);
 		return;
 	}
+	InputLatency::GetInstance().Presented();
+}
+
+constexpr UINT_PTR frameTimer = 1;
+// Only runs while something is animating.
+constexpr UINT_PTR animationTimer = 2;
+FrameScheduler frameScheduler{ std::chrono::milliseconds{ 16 } };
+
+// Frames are paced to the monitor; fall back to 60 Hz when it won't say.
+std::chrono::steady_clock::duration RefreshInterval(HWND hwnd)
+{
+	HDC dc = GetDC(hwnd);
+	int hertz = GetDeviceCaps(dc, VREFRESH);
+	ReleaseDC(hwnd, dc);
+	if (hertz <= 1) {
+		hertz = 60;
+	}
+	return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::seconds{ 1 }) / hertz;
+}
+
+void ScheduleFrame(HWND hwnd)
+{
+	if (auto delay = frameScheduler.Request()) {
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(*delay).count();
+		SetTimer(hwnd, frameTimer, static_cast<UINT>((std::max)(ms, decltype(ms){ 1 })), nullptr);
+	}
+}
+
+void Feed(InputEvent const& event)
+{
+	if (inputRecorder) {
+		inputRecorder->Record(event);
+	}
+	application->Post(event);
+	if (event.kind == InputEvent::Kind::PointerMove) {
+		ScheduleFrame(hwnd);
+	}
+}
+
+void ApplyPendingSize()
+{
+	if (sizePending) {
+		renderTarget->Resize(&pendingSize);
+		sizePending = false;
+	}
+}
+
+void BeginLiveResize()
+{
+	liveResize = true;
+	// The back buffer still holds the last frame.
+	float dpiX, dpiY;
+	renderTarget->GetDpi(&dpiX, &dpiY);
+	resizePreview.Release();
+	HRESULT hr = renderTarget->CreateBitmap(renderTarget->GetPixelSize(),
+		D2D1::BitmapProperties(renderTarget->GetPixelFormat(), dpiX, dpiY), &resizePreview);
+	if (FAILED(hr) || FAILED(resizePreview->CopyFromRenderTarget(nullptr, renderTarget, nullptr))) {
+		resizePreview.Release();
+	}
+}
+
+void DrawResizePreview(HWND hwnd)
+{
+	ApplyPendingSize();
+	renderTarget->BeginDraw();
+	renderTarget->Clear(ToD2D(backgroundColor));
+	if (resizePreview) {
+		auto size = resizePreview->GetSize();
+		renderTarget->DrawBitmap(resizePreview, D2D1::RectF(0.f, 0.f, size.width, size.height),
+			1.f, D2D1_BITMAP_INTERPOLATION_MODE_NEAREST_NEIGHBOR);
+	}
+	if (renderTarget->EndDraw() == D2DERR_RECREATE_TARGET) {
+		RecoverDeviceLoss(hwnd);
+	}
+}
+
+// One full-quality layout and paint at the final size.
+void EndLiveResize(HWND hwnd)
+{
+	liveResize = false;
+	resizePreview.Release();
+	ApplyPendingSize();
+	RECT client;
+	GetClientRect(hwnd, &client);
+	Feed(InputEvent::Resize({ static_cast<float>(client.right), static_cast<float>(client.bottom) }));
+	InvalidateRect(hwnd, nullptr, FALSE);
+}
+
+// Hands everything invalidated since the last frame to Windows and paints it
+// right away. The timer is only kept while more frames are wanted.
+void OnFrameTimer(HWND hwnd)
+{
+	// Held pointer moves are hit-tested once, against the latest position;
+	// what they invalidate joins this frame.
+	application->Pump();
+	if (frameScheduler.Tick()) {
+		if (liveResize) {
+			DrawResizePreview(hwnd);
+		} else {
+			Rect dirty = ControlContainer::GetInstance().TakeDirty();
+			if (!RectangleIsEmpty(dirty)) {
+				RECT rect{
+					static_cast<LONG>(dirty.left) - 1, static_cast<LONG>(dirty.top) - 1,
+					static_cast<LONG>(dirty.right) + 2, static_cast<LONG>(dirty.bottom) + 2
+				};
+				InvalidateRect(hwnd, &rect, FALSE);
+			}
+			UpdateWindow(hwnd);
+		}
+	}
+	if (!frameScheduler.Pending()) {
+		KillTimer(hwnd, frameTimer);
+	}
+}
+
+// Times the paint and hover passes over a few thousand throwaway controls in
+// both dispatch modes. Bound to F9.
+VOID RunDispatchBenchmark(HWND hwnd)
+{
+	constexpr int controlCount = 3000;
+	constexpr int passes = 50;
+	auto& controls = ControlContainer::GetInstance();
+
+	std::vector<ControlHandle> spawned;
+	spawned.reserve(controlCount);
+	for (int i = 0; i < controlCount; ++i) {
+		float x = static_cast<float>(i % 60) * 10.f, y = static_cast<float>(i / 60) * 10.f;
+		Rect area{ x, y, x + 8.f, y + 8.f };
+		Control* control;
+		switch (i % 3) {
+		case 0: control = new Label{ area, L"x" }; break;
+		case 1: control = new TextBox{ area }; break;
+		default: control = new Button{ area }; break;
+		}
+		spawned.emplace_back(control->Handle());
+	}
+
+	auto size = renderTarget->GetSize();
+	Rect client{ 0.f, 0.f, size.width, size.height };
+	Direct2DRenderer renderer;
+	auto measure = [&](ControlContainer::DispatchMode mode) {
+		controls.SetMode(mode);
+		auto start = std::chrono::steady_clock::now();
+		renderTarget->BeginDraw();
+		for (int i = 0; i < passes; ++i) {
+			controls.Paint(renderer, client);
+		}
+		renderTarget->EndDraw();
+		auto painted = std::chrono::steady_clock::now();
+		for (int i = 0; i < passes; ++i) {
+			controls.OnHover({ static_cast<float>(i * 7 % 600), static_cast<float>(i * 13 % 500) });
+		}
+		auto hovered = std::chrono::steady_clock::now();
+		using us = std::chrono::microseconds;
+		return std::pair{
+			std::chrono::duration_cast<us>(painted - start).count() / passes,
+			std::chrono::duration_cast<us>(hovered - painted).count() / passes
+		};
+	};
+
+	renderTarget->BeginDraw();
+	compositor.SetBackend(&renderer);
+	controls.Paint(compositor, client);
+	compositor.Flush(renderer);
+	compositor.SetBackend(nullptr);
+	renderTarget->EndDraw();
+	CompositorStats batching = compositor.Stats();
+
+	auto previous = controls.Mode();
+	auto [virtualPaint, virtualHover] = measure(ControlContainer::DispatchMode::Virtual);
+	auto [typedPaint, typedHover] = measure(ControlContainer::DispatchMode::Typed);
+	controls.SetMode(previous);
+
+	for (auto handle : spawned) {
+		controls.Remove(handle);
+	}
+	InvalidateRect(hwnd, nullptr, FALSE);
+
+	FrameStats frames = frameScheduler.Stats();
+	std::wstring report = L"Controls: " + std::to_wstring(controls.Size() + controlCount)
+		+ L"\nVirtual: paint " + std::to_wstring(virtualPaint) + L" us, hover " + std::to_wstring(virtualHover) + L" us"
+		+ L"\nTyped: paint " + std::to_wstring(typedPaint) + L" us, hover " + std::to_wstring(typedHover) + L" us"
+		+ L"\nBatched: " + std::to_wstring(batching.primitives) + L" primitives in " + std::to_wstring(batching.batches)
+		+ L" batches, " + std::to_wstring(batching.backendCalls) + L" backend calls"
+		+ L"\nFrames: " + std::to_wstring(frames.frames) + L" for " + std::to_wstring(frames.requests) + L" requests, idle "
+		+ std::to_wstring(std::chrono::duration_cast<std::chrono::milliseconds>(frames.idle).count()) + L" ms";
+	MessageBoxW(hwnd, report.c_str(), L"Dispatch benchmark", MB_OK);
+}
+
+// Paints a scene in which only one control in twenty is on screen, walking
+// every root and then through the spatial index. Bound to F8.
+VOID RunCullingBenchmark(HWND hwnd)
+{
+	constexpr int controlCount = 20000;
+	constexpr int passes = 50;
+	auto& controls = ControlContainer::GetInstance();
+
+	auto size = renderTarget->GetSize();
+	Rect client{ 0.f, 0.f, size.width, size.height };
+	std::vector<ControlHandle> spawned;
+	spawned.reserve(controlCount);
+	for (int i = 0; i < controlCount; ++i) {
+		float x = static_cast<float>(i % 50) * 10.f, y = static_cast<float>(i / 50 % 20) * 10.f;
+		if (i % 20) {
+			// Off screen, below the client area.
+			y += size.height + static_cast<float>(i / 1000) * 200.f;
+		}
+		Rect area{ x, y, x + 8.f, y + 8.f };
+		Control* control;
+		switch (i % 3) {
+		case 0: control = new Label{ area, L"x" }; break;
+		case 1: control = new TextBox{ area }; break;
+		default: control = new Button{ area }; break;
+		}
+		spawned.emplace_back(control->Handle());
+	}
+
+	Direct2DRenderer renderer;
+	auto measure = [&](bool indexed) {
+		controls.SetSpatialIndex(indexed);
+		auto start = std::chrono::steady_clock::now();
+		renderTarget->BeginDraw();
+		for (int i = 0; i < passes; ++i) {
+			controls.Paint(renderer, client);
+		}
+		renderTarget->EndDraw();
+		auto painted = std::chrono::steady_clock::now();
+		return std::pair{
+			std::chrono::duration_cast<std::chrono::microseconds>(painted - start).count() / passes,
+			controls.LastPaint()
+		};
+	};
+
+	auto previousMode = controls.Mode();
+	auto previousIndex = controls.SpatialIndex();
+	controls.SetMode(ControlContainer::DispatchMode::Virtual);
+	auto [walkTime, walk] = measure(false);
+	auto [indexTime, index] = measure(true);
+	controls.SetSpatialIndex(previousIndex);
+	controls.SetMode(previousMode);
+
+	for (auto handle : spawned) {
+		controls.Remove(handle);
+	}
+	InvalidateRect(hwnd, nullptr, FALSE);
+
+	std::wstring report = L"Controls: " + std::to_wstring(controls.Size() + controlCount)
+		+ L"\nWalk: " + std::to_wstring(walkTime) + L" us, visited " + std::to_wstring(walk.visited) + L", painted " + std::to_wstring(walk.controls)
+		+ L"\nIndexed: " + std::to_wstring(indexTime) + L" us, visited " + std::to_wstring(index.visited) + L", painted " + std::to_wstring(index.controls);
+	MessageBoxW(hwnd, report.c_str(), L"Culling benchmark", MB_OK);
+}
+
+// Display lists are rebuilt on these threads; Direct2D itself stays on the
+// UI thread, so the factory remains single-threaded.
+ThreadPool recordPool;
+// Runs WhenChangeAsync work; results come back through UiQueue, which posts
+// uiQueueMessage and is drained between messages. Built in WinMain and shut
+// down before it returns.
+std::optional<Executor> backgroundExecutor;
+constexpr UINT uiQueueMessage = WM_APP;
+
+// Stamps event with the time its message was posted, so latency includes the
+// time it waited in the queue. Message times have millisecond resolution.
+void FeedMessage(InputEvent event)
+{
+	auto age = static_cast<DWORD>(GetTickCount() - static_cast<DWORD>(GetMessageTime()));
+	event.time = std::chrono::steady_clock::now() - std::chrono::milliseconds{ age };
+	Feed(event);
+}
+
+// Shows the keystroke latency histograms. Bound to F6.
+VOID ShowInputLatency(HWND hwnd)
+{
+	std::string report = InputLatency::GetInstance().Report();
+	MessageBoxW(hwnd, std::wstring(report.begin(), report.end()).c_str(), L"Input latency", MB_OK);
+}
+
+Point ClientPoint(LPARAM lParam)
+{
+	return { static_cast<float>(GET_X_LPARAM(lParam)), static_cast<float>(GET_Y_LPARAM(lParam)) };
 }
 
 LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
@@ -335,31 +677,103 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 	switch (message)
 	{
 	case WM_PAINT:
+		if (liveResize) {
+			// Exposed areas are covered by the next preview frame.
+			ValidateRect(hwnd, nullptr);
+			ScheduleFrame(hwnd);
+			return 0;
+		}
 		DrawRectangle(hwnd);
 		return 0;
 	case WM_MOUSEMOVE:
-		ControlContainer::GetInstance().OnHover(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		FeedMessage(InputEvent::PointerMove(ClientPoint(lParam)));
 		return 0;
 	case WM_LBUTTONDOWN:
-		ControlContainer::GetInstance().OnClick(GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam));
+		FeedMessage(InputEvent::PointerDown(ClientPoint(lParam)));
+		return 0;
+	case WM_MOUSEWHEEL: {
+		POINT point{ GET_X_LPARAM(lParam), GET_Y_LPARAM(lParam) };
+		ScreenToClient(hwnd, &point);
+		FeedMessage(InputEvent::Wheel({ static_cast<float>(point.x), static_cast<float>(point.y) }, GET_WHEEL_DELTA_WPARAM(wParam)));
 		return 0;
+	}
 	case WM_LBUTTONUP:
-		ControlContainer::GetInstance().LeaveClick();
+		FeedMessage(InputEvent::PointerUp(ClientPoint(lParam)));
 		return 0;
 	case WM_CHAR:
-		ControlContainer::GetInstance().OnChar(wParam);
+		FeedMessage(InputEvent::Char(static_cast<wchar_t>(wParam)));
 		return 0;
 	case WM_KEYDOWN:
-		ControlContainer::GetInstance().OnKeyDown(wParam);
+		if (wParam == VK_F6) {
+			ShowInputLatency(hwnd);
+			return 0;
+		}
+		if (wParam == VK_F9) {
+			RunDispatchBenchmark(hwnd);
+			return 0;
+		}
+		if (wParam == VK_F8) {
+			RunCullingBenchmark(hwnd);
+			return 0;
+		}
+		FeedMessage(InputEvent::Key(static_cast<unsigned>(wParam)));
+		return 0;
+	case WM_TIMER:
+		if (wParam == frameTimer) {
+			OnFrameTimer(hwnd);
+			return 0;
+		}
+		if (wParam == animationTimer) {
+			if (!Animator::GetInstance().Advance()) {
+				KillTimer(hwnd, animationTimer);
+			}
+			return 0;
+		}
+		break;
+	case uiQueueMessage:
+		UiQueue::GetInstance().Drain();
 		return 0;
+	case WM_DISPLAYCHANGE:
+		frameScheduler.SetInterval(RefreshInterval(hwnd));
+		break;
 	case WM_DESTROY:
+		if (inputRecorder && !inputRecorder->Save(inputRecordingPath)) {
+			MessageBoxW(hwnd, L"Failed to save the input recording", L"error", MB_ICONERROR);
+		}
 		PostQuitMessage(0);
 		return 0;
+	case WM_ENTERSIZEMOVE:
+		sizeMove = true;
+		return 0;
+	case WM_EXITSIZEMOVE:
+		sizeMove = false;
+		if (liveResize) {
+			EndLiveResize(hwnd);
+		}
+		return 0;
 	case WM_SIZE: {
 		D2D1_SIZE_U resize{ .width = LOWORD(lParam), .height = HIWORD(lParam) };
+		if (sizeMove && !liveResize && renderTarget != nullptr) {
+			// The target is still at the old size, so the preview holds the last
+			// full frame.
+			auto current = renderTarget->GetPixelSize();
+			if (current.width != resize.width || current.height != resize.height) {
+				BeginLiveResize();
+			}
+		}
+		if (liveResize) {
+			// Applied by the next preview frame rather than at mouse rate.
+			pendingSize = resize;
+			sizePending = true;
+			ScheduleFrame(hwnd);
+			return 0;
+		}
 		if (renderTarget != nullptr) {
 			renderTarget->Resize(&resize);
 		}
+		if (application) {
+			Feed(InputEvent::Resize({ static_cast<float>(resize.width), static_cast<float>(resize.height) }));
+		}
 		return 0;
 	}
 	}
@@ -369,11 +783,50 @@ LRESULT CALLBACK WndProc(HWND hwnd, UINT message, WPARAM wParam, LPARAM lParam)
 
 int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR szCmdLine, int iCmdShow)
 {
+	std::string_view command{ szCmdLine ? szCmdLine : "" };
+	// "--input-benchmark <file>" drives the application headlessly with a
+	// scripted input sequence and writes the latencies to <file>.
+	if (constexpr std::string_view flag{ "--input-benchmark " }; command.starts_with(flag)) {
+		std::ofstream{ std::filesystem::path{ command.substr(flag.size()) } } << RunInputBenchmark();
+		return 0;
+	}
+	// "--replay-input <file>" replays a recorded session at its recorded pace,
+	// "--replay-input-fast <file>" as fast as frames finish, and
+	// "--replay-input-batched <file>" at its recorded pace with 60 Hz frames
+	// that coalesce pointer moves. The latency report is written to <file>.txt.
+	struct Replay {
+		std::string_view flag;
+		ReplaySpeed speed;
+		std::chrono::microseconds frameInterval;
+	};
+	for (auto [flag, speed, frameInterval] : {
+		Replay{ "--replay-input ", ReplaySpeed::Recorded, std::chrono::microseconds{ 0 } },
+		Replay{ "--replay-input-fast ", ReplaySpeed::Maximum, std::chrono::microseconds{ 0 } },
+		Replay{ "--replay-input-batched ", ReplaySpeed::Recorded, std::chrono::microseconds{ 16667 } } }) {
+		if (command.starts_with(flag)) {
+			std::filesystem::path path{ command.substr(flag.size()) };
+			try {
+				std::ofstream{ path.string() + ".txt" } << ReplayInput(LoadInput(path), speed, frameInterval);
+			}
+			catch (std::runtime_error const& error) {
+				std::string what = error.what();
+				MessageBoxW(nullptr, std::wstring(what.begin(), what.end()).c_str(), L"error", MB_ICONERROR);
+				return 1;
+			}
+			return 0;
+		}
+	}
+	if (constexpr std::string_view flag{ "--record-input " }; command.starts_with(flag)) {
+		inputRecordingPath = command.substr(flag.size());
+		inputRecorder.emplace();
+	}
+
 	WNDCLASSEX winClass{};
 
 	winClass.lpszClassName = L"Direct2D";
 	winClass.cbSize = sizeof(WNDCLASSEX);
-	winClass.style = CS_HREDRAW | CS_VREDRAW;
+	// No CS_HREDRAW | CS_VREDRAW: a resize only repaints what it uncovers.
+	winClass.style = 0;
 	winClass.lpfnWndProc = WndProc;
 	winClass.hInstance = hInstance;
 	winClass.hIcon = NULL;
@@ -403,7 +856,32 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR szCmdLine, int i
 		hInstance,					// program instance handle
 		NULL);						// creation parameters
 
-	UserInterface();
+	// Invalidations only collect into the container's dirty region; the frame
+	// timer turns them into at most one paint per refresh.
+	frameScheduler.SetInterval(RefreshInterval(hwnd));
+	ControlContainer::GetInstance().WhenInvalidate([](Rect) {
+		ScheduleFrame(hwnd);
+	});
+	ControlContainer::GetInstance().SetRecordPool(&recordPool);
+	backgroundExecutor.emplace();
+	ControlContainer::GetInstance().SetBackgroundExecutor(&*backgroundExecutor);
+	UiQueue::GetInstance().WhenPosted([]() {
+		PostMessageW(hwnd, uiQueueMessage, 0, 0);
+	});
+	Animator::GetInstance().WhenActive([](Animator::Duration tick) {
+		auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(tick).count();
+		SetTimer(hwnd, animationTimer, static_cast<UINT>(ms), nullptr);
+	});
+	RegisterBrushes();
+	if (!CreateRenderTarget(hwnd))
+	{
+		return 0;
+	}
+	application.emplace();
+
+	RECT client;
+	GetClientRect(hwnd, &client);
+	Feed(InputEvent::Resize({ static_cast<float>(client.right), static_cast<float>(client.bottom) }));
 
 	ShowWindow(hwnd, iCmdShow);
 	UpdateWindow(hwnd);
@@ -415,5 +893,12 @@ int WinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPSTR szCmdLine, int i
 		DispatchMessageW(&msg);
 	}
 
+	// Work still running finishes here and posts to UiQueue, a function-local
+	// static that would otherwise be destroyed before this global.
+	ControlContainer::GetInstance().SetBackgroundExecutor(nullptr);
+	backgroundExecutor.reset();
+	// The container singleton was first built in WinMain, after this global,
+	// so it is destroyed first; the controls must be removed before that.
+	application.reset();
 	return static_cast<int>(msg.wParam);
 }
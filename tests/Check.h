@@ -0,0 +1,11 @@
+#pragma once
+#include <cstdio>
+
+// A failed CHECK is reported and counted; a test's main returns Failures().
+inline int& Failures() {
+	static int failures = 0;
+	return failures;
+}
+
+#define CHECK(condition) \
+	((condition) ? (void)0 : (std::fprintf(stderr, "%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #condition), (void)++Failures()))
@@ -0,0 +1,108 @@
+#include <string>
+#include "Check.h"
+#include "Controls.h"
+#include "SoftwareRenderer.h"
+
+namespace {
+	bool SameRect(Rect a, Rect b) {
+		return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+	}
+
+	void ControlsRecordTheirCommands() {
+		auto& controls = ControlContainer::GetInstance();
+		Rect labelArea{ 10.f, 10.f, 110.f, 30.f };
+		auto label = new Label{ labelArea, L"hello" };
+		auto const& labelList = label->Display();
+		CHECK(labelList.Commands().size() == 1);
+		if (labelList.Commands().size() == 1) {
+			auto const& text = labelList.Commands()[0];
+			CHECK(text.kind == DrawCommand::Kind::DrawText);
+			CHECK(text.brush == Brush::TextWrite);
+			CHECK(SameRect(text.rect, labelArea));
+			CHECK(labelList.Text(text) == L"hello");
+		}
+
+		Rect boxArea{ 10.f, 40.f, 110.f, 60.f };
+		auto box = new TextBox{ boxArea };
+		box->OnChar(L'h');
+		box->OnChar(L'i');
+		auto const& boxList = box->Display();
+		CHECK(boxList.Commands().size() == 2);
+		if (boxList.Commands().size() == 2) {
+			CHECK(boxList.Commands()[0].kind == DrawCommand::Kind::DrawRectangle);
+			CHECK(boxList.Commands()[0].brush == Brush::TextBoxBorder);
+			CHECK(SameRect(boxList.Commands()[0].rect, boxArea));
+			CHECK(boxList.Commands()[1].kind == DrawCommand::Kind::DrawText);
+			CHECK(boxList.Text(boxList.Commands()[1]) == L"hi");
+		}
+
+		Rect buttonArea{ 10.f, 70.f, 110.f, 90.f };
+		auto button = new Button{ buttonArea };
+		auto const& buttonList = button->Display();
+		CHECK(buttonList.Commands().size() == 1);
+		if (buttonList.Commands().size() == 1) {
+			CHECK(buttonList.Commands()[0].kind == DrawCommand::Kind::FillRectangle);
+			CHECK(buttonList.Commands()[0].brush == Brush::ButtonNormal);
+			CHECK(SameRect(buttonList.Commands()[0].rect, buttonArea));
+		}
+
+		Rect listArea{ 10.f, 100.f, 110.f, 160.f };
+		auto list = new ListView{ listArea };
+		list->SetItems(1000, [](std::size_t index) { return L"row " + std::to_wstring(index); });
+		auto const& listList = list->Display();
+		auto commands = listList.Commands();
+		// Border, clip, the three rows in view, unclip.
+		CHECK(commands.size() == 6);
+		if (commands.size() == 6) {
+			CHECK(commands[0].kind == DrawCommand::Kind::DrawRectangle);
+			CHECK(commands[1].kind == DrawCommand::Kind::PushClip);
+			CHECK(SameRect(commands[1].rect, listArea));
+			for (std::size_t row = 0; row < 3; ++row) {
+				auto const& text = commands[2 + row];
+				CHECK(text.kind == DrawCommand::Kind::DrawText);
+				CHECK(listList.Text(text) == L"row " + std::to_wstring(row));
+				CHECK(text.rect.top == listArea.top + 20.f * static_cast<float>(row));
+			}
+			CHECK(commands[5].kind == DrawCommand::Kind::PopClip);
+		}
+
+		for (Control* control : { static_cast<Control*>(label), static_cast<Control*>(box), static_cast<Control*>(button), static_cast<Control*>(list) }) {
+			controls.Remove(control->Handle());
+		}
+	}
+
+	// Painting re-records only the controls whose state changed since the
+	// last paint.
+	void OnlyChangedControlsAreReRecorded() {
+		auto& controls = ControlContainer::GetInstance();
+		SoftwareRenderer renderer{ 200, 200 };
+		Rect frame{ 0.f, 0.f, 200.f, 200.f };
+		auto label = new Label{ { 10.f, 10.f, 110.f, 30.f }, L"before" };
+		auto button = new Button{ { 10.f, 40.f, 110.f, 60.f } };
+		auto paint = [&]() {
+			controls.TakeDirty();
+			controls.Paint(renderer, frame);
+			renderer.EndFrame();
+			return controls.LastPaint().recorded;
+		};
+
+		CHECK(paint() == 2);
+		CHECK(paint() == 0);
+		label->Text(L"before");
+		CHECK(paint() == 0);
+		label->Text(L"after");
+		CHECK(paint() == 1);
+		auto const& list = label->Display();
+		CHECK(list.Commands().size() == 1 && list.Text(list.Commands()[0]) == L"after");
+		CHECK(paint() == 0);
+
+		controls.Remove(label->Handle());
+		controls.Remove(button->Handle());
+	}
+}
+
+int main() {
+	ControlsRecordTheirCommands();
+	OnlyChangedControlsAreReRecorded();
+	return Failures();
+}
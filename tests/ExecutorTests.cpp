@@ -0,0 +1,117 @@
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "Check.h"
+#include "Executor.h"
+
+namespace {
+	void EveryTaskRunsBeforeDestruction() {
+		std::atomic<int> ran{ 0 };
+		{
+			Executor executor{ 3 };
+			for (int i = 0; i < 1000; ++i) {
+				executor.Submit([&]() { ran.fetch_add(1); });
+			}
+			CHECK(executor.Stats().submitted == 1000);
+		}
+		CHECK(ran.load() == 1000);
+	}
+
+	// A worker queues tasks on its own deque and then waits for them, so
+	// every one of them has to be stolen by another worker.
+	void IdleWorkersStealFromABusyOne() {
+		constexpr int children = 64;
+		Executor executor{ 4 };
+		std::mutex mutex;
+		std::condition_variable finished;
+		int done = 0;
+		executor.Submit([&]() {
+			for (int i = 0; i < children; ++i) {
+				executor.Submit([&]() {
+					std::lock_guard lock{ mutex };
+					++done;
+					finished.notify_all();
+				});
+			}
+			std::unique_lock lock{ mutex };
+			finished.wait(lock, [&]() { return done == children; });
+		});
+		{
+			std::unique_lock lock{ mutex };
+			finished.wait(lock, [&]() { return done == children; });
+		}
+		CHECK(executor.Stats().stolen >= children);
+	}
+
+	void AsyncResultsArriveThroughTheUiQueue() {
+		Executor executor{ 2 };
+		std::atomic<bool> worked{ false };
+		std::thread::id doneOn;
+		int result = 0;
+		executor.Async([&]() { worked = true; return 42; }, [&](int value) {
+			result = value;
+			doneOn = std::this_thread::get_id();
+		});
+		while (!result) {
+			UiQueue::GetInstance().Drain();
+		}
+		CHECK(worked.load());
+		CHECK(result == 42);
+		CHECK(doneOn == std::this_thread::get_id());
+	}
+
+	// Posts from several threads all run on the draining thread, each
+	// thread's in the order it posted them, and WhenPosted fires once per
+	// drained-to-non-empty transition.
+	void UiQueueKeepsEachProducersOrder() {
+		constexpr int producers = 4, posts = 2000;
+		auto& queue = UiQueue::GetInstance();
+		queue.Drain();
+		std::atomic<int> signals{ 0 };
+		queue.WhenPosted([&]() { signals.fetch_add(1); });
+
+		queue.Post([]() {});
+		queue.Post([]() {});
+		CHECK(signals.load() == 1);
+		CHECK(queue.Drain() == 2);
+		queue.Post([]() {});
+		CHECK(signals.load() == 2);
+		queue.Drain();
+
+		std::vector<std::vector<int>> seen(producers);
+		std::vector<std::thread> threads;
+		for (int p = 0; p < producers; ++p) {
+			threads.emplace_back([&, p]() {
+				for (int i = 0; i < posts; ++i) {
+					queue.Post([&, p, i]() { seen[p].push_back(i); });
+				}
+			});
+		}
+		std::size_t ran = 0;
+		while (ran < producers * posts) {
+			ran += queue.Drain();
+		}
+		for (auto& thread : threads) {
+			thread.join();
+		}
+		CHECK(queue.Drain() == 0);
+		for (auto const& order : seen) {
+			CHECK(order.size() == posts);
+			for (std::size_t i = 0; i < order.size(); ++i) {
+				CHECK(order[i] == static_cast<int>(i));
+			}
+		}
+		queue.WhenPosted([]() {});
+	}
+}
+
+int main() {
+	EveryTaskRunsBeforeDestruction();
+	IdleWorkersStealFromABusyOne();
+	AsyncResultsArriveThroughTheUiQueue();
+	UiQueueKeepsEachProducersOrder();
+	return Failures();
+}
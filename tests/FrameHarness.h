@@ -0,0 +1,236 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+#include "Controls.h"
+#include "Layout.h"
+#include "SoftwareRenderer.h"
+#include "Application.h"
+
+// Heap allocations made so far. The counter only moves in a program that
+// replaces the global operator new to bump it and sets allocationsCounted, as
+// the GoldenFrames test does; otherwise allocation budgets are not checked.
+inline std::atomic<std::size_t> allocationCount{ 0 };
+inline bool allocationsCounted = false;
+
+// Binary PPM (P6). Alpha is dropped; frames are opaque.
+inline bool WritePpm(std::filesystem::path const& path, Framebuffer const& frame) {
+	std::ofstream out{ path, std::ios::binary };
+	out << "P6\n" << frame.width << ' ' << frame.height << "\n255\n";
+	for (std::uint32_t pixel : frame.pixels) {
+		char rgb[3]{ static_cast<char>(pixel >> 16), static_cast<char>(pixel >> 8), static_cast<char>(pixel) };
+		out.write(rgb, 3);
+	}
+	return static_cast<bool>(out);
+}
+
+inline std::optional<Framebuffer> ReadPpm(std::filesystem::path const& path) {
+	std::ifstream in{ path, std::ios::binary };
+	std::string magic;
+	int width = 0, height = 0, maxValue = 0;
+	if (!(in >> magic >> width >> height >> maxValue) || magic != "P6" || maxValue != 255 || width <= 0 || height <= 0) {
+		return std::nullopt;
+	}
+	in.get();
+	Framebuffer frame;
+	frame.Resize(width, height);
+	for (auto& pixel : frame.pixels) {
+		unsigned char rgb[3];
+		if (!in.read(reinterpret_cast<char*>(rgb), 3)) {
+			return std::nullopt;
+		}
+		pixel = 0xFF000000u | std::uint32_t{ rgb[0] } << 16 | std::uint32_t{ rgb[1] } << 8 | rgb[2];
+	}
+	return frame;
+}
+
+// Frames of different sizes differ everywhere.
+inline std::size_t DifferingPixels(Framebuffer const& a, Framebuffer const& b) {
+	if (a.width != b.width || a.height != b.height) {
+		return (std::max)(a.pixels.size(), b.pixels.size());
+	}
+	std::size_t differing = 0;
+	for (std::size_t i = 0; i < a.pixels.size(); ++i) {
+		// Compared as stored: PPM keeps no alpha.
+		differing += (a.pixels[i] & 0xFFFFFF) != (b.pixels[i] & 0xFFFFFF);
+	}
+	return differing;
+}
+
+// Check compares frames with their images only. Budgets also holds each frame
+// to its time and allocation budget, which depend on the machine, the build
+// and the standard library, so it is opt-in. Record writes images and budgets.
+enum class GoldenMode {
+	Check,
+	Budgets,
+	Record,
+};
+
+struct FrameBudget {
+	long long microseconds{ 0 };
+	std::size_t allocations{ 0 };
+};
+
+struct FrameResult {
+	std::string name;
+	bool passed{ true };
+	std::size_t differingPixels{ 0 };
+	long long microseconds{ 0 };
+	std::size_t allocations{ 0 };
+	std::string problem;
+};
+
+// Renders the controls into a software framebuffer and checks each frame
+// against <directory>/<name>.ppm and, in Budgets mode, the budgets in
+// <directory>/budgets.txt. In Record mode the images and budgets are written
+// instead. Recorded budgets leave headroom for timing noise.
+class FrameHarness {
+private:
+	std::filesystem::path _directory;
+	GoldenMode _mode;
+	SoftwareRenderer _renderer;
+	std::map<std::string, FrameBudget> _budgets;
+	std::vector<FrameResult> _results;
+
+	std::filesystem::path BudgetPath() const {
+		return _directory / "budgets.txt";
+	}
+
+	void LoadBudgets() {
+		std::ifstream in{ BudgetPath() };
+		std::string name;
+		FrameBudget budget;
+		while (in >> name >> budget.microseconds >> budget.allocations) {
+			_budgets[name] = budget;
+		}
+	}
+
+	void CheckBudget(FrameResult& result) const {
+		auto budget = _budgets.find(result.name);
+		if (budget == _budgets.end()) {
+			result.passed = false;
+			result.problem = "no budget";
+		} else if (result.microseconds > budget->second.microseconds) {
+			result.passed = false;
+			result.problem = "took " + std::to_string(result.microseconds) + " us, budget " + std::to_string(budget->second.microseconds);
+		} else if (allocationsCounted && result.allocations > budget->second.allocations) {
+			result.passed = false;
+			result.problem = std::to_string(result.allocations) + " allocations, budget " + std::to_string(budget->second.allocations);
+		}
+	}
+
+public:
+	FrameHarness(std::filesystem::path directory, GoldenMode mode, int width, int height)
+		: _directory{ std::move(directory) }, _mode{ mode }, _renderer{ width, height } {
+		if (_mode == GoldenMode::Record) {
+			std::filesystem::create_directories(_directory);
+		} else if (_mode == GoldenMode::Budgets) {
+			LoadBudgets();
+		}
+	}
+
+	// Paints every control as one full frame and checks it as name.
+	FrameResult const& Check(std::string const& name) {
+		auto& controls = ControlContainer::GetInstance();
+		auto const& target = _renderer.Target();
+		Rect frame{ 0.f, 0.f, static_cast<float>(target.width), static_cast<float>(target.height) };
+
+		std::size_t allocationsBefore = allocationCount.load(std::memory_order_relaxed);
+		auto start = std::chrono::steady_clock::now();
+		_renderer.Clear(backgroundColor);
+		controls.Paint(_renderer, frame);
+		_renderer.EndFrame();
+		auto elapsed = std::chrono::steady_clock::now() - start;
+
+		FrameResult result;
+		result.name = name;
+		result.microseconds = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+		result.allocations = allocationCount.load(std::memory_order_relaxed) - allocationsBefore;
+
+		auto image = _directory / (name + ".ppm");
+		if (_mode == GoldenMode::Record) {
+			WritePpm(image, target);
+			_budgets[name] = { (std::max)(result.microseconds * 3, result.microseconds + 2000), result.allocations + result.allocations / 4 };
+		} else if (auto golden = ReadPpm(image)) {
+			result.differingPixels = DifferingPixels(*golden, target);
+			if (result.differingPixels) {
+				result.passed = false;
+				result.problem = std::to_string(result.differingPixels) + " pixels differ";
+				WritePpm(_directory / (name + ".actual.ppm"), target);
+			} else if (_mode == GoldenMode::Budgets) {
+				CheckBudget(result);
+			}
+		} else {
+			result.passed = false;
+			result.problem = "no golden image";
+		}
+		return _results.emplace_back(std::move(result));
+	}
+
+	// Writes the budgets when recording. Returns the number of failed frames.
+	std::size_t Finish() {
+		if (_mode == GoldenMode::Record) {
+			std::ofstream out{ BudgetPath() };
+			for (auto const& [name, budget] : _budgets) {
+				out << name << ' ' << budget.microseconds << ' ' << budget.allocations << '\n';
+			}
+		}
+		std::size_t failures = 0;
+		for (auto const& result : _results) {
+			failures += !result.passed;
+		}
+		return failures;
+	}
+
+	std::vector<FrameResult> const& Results() const {
+		return _results;
+	}
+
+	std::string Report() const {
+		std::string report;
+		for (auto const& result : _results) {
+			report += (result.passed ? "ok   " : "FAIL ") + result.name + ": " + std::to_string(result.microseconds) + " us, "
+				+ std::to_string(result.allocations) + " allocations" + (result.problem.empty() ? "" : ", " + result.problem) + '\n';
+		}
+		return report;
+	}
+};
+
+// Builds an Application into an empty container and drives it through the
+// standard frames: the first paint, text typed into the input, and the
+// number list scrolled. Writes report.txt next to the images and returns
+// the number of failed frames.
+inline std::size_t RunGoldenFrames(std::filesystem::path const& directory, GoldenMode mode) {
+	constexpr int width = 400, height = 500;
+	auto& controls = ControlContainer::GetInstance();
+	Application application;
+	application.Resize({ static_cast<float>(width), static_cast<float>(height) });
+	auto const& ui = application.Handles();
+	auto center = [&](ControlHandle handle) {
+		Rect area = controls.Get<Control>(handle)->Area();
+		return Point{ (area.left + area.right) / 2.f, (area.top + area.bottom) / 2.f };
+	};
+
+	FrameHarness harness{ directory, mode, width, height };
+	harness.Check("initial");
+
+	application.Dispatch(InputEvent::PointerDown(center(ui.input)));
+	application.Dispatch(InputEvent::PointerUp(center(ui.input)));
+	for (wchar_t ch : std::wstring_view{ L"golden frame" }) {
+		application.Dispatch(InputEvent::Char(ch));
+	}
+	harness.Check("typed");
+
+	application.Dispatch(InputEvent::Wheel(center(ui.numbers), -120 * 5));
+	harness.Check("scrolled");
+
+	std::size_t failures = harness.Finish();
+	std::ofstream{ directory / "report.txt" } << harness.Report();
+	return failures;
+}
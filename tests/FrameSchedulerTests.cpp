@@ -0,0 +1,82 @@
+#include <chrono>
+#include "Check.h"
+#include "FrameScheduler.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+	// The scheduler reads the time only through this, so each test moves it by hand.
+	struct FakeClock {
+		FrameScheduler::TimePoint now{};
+
+		FrameScheduler Scheduler(FrameScheduler::Duration interval) {
+			return FrameScheduler{ interval, [this]() { return now; } };
+		}
+	};
+
+	void ManyRequestsBetweenTicksGiveOneFrame() {
+		FakeClock clock;
+		FrameScheduler scheduler = clock.Scheduler(16ms);
+		auto delay = scheduler.Request();
+		CHECK(delay && *delay == 0ms);
+		for (int i = 0; i < 9; ++i) {
+			CHECK(!scheduler.Request());
+		}
+		CHECK(scheduler.Tick());
+		CHECK(!scheduler.Tick());
+		FrameStats stats = scheduler.Stats();
+		CHECK(stats.frames == 1);
+		CHECK(stats.requests == 10);
+		CHECK(stats.coalesced == 9);
+	}
+
+	void EarlyTickReturnsFalse() {
+		FakeClock clock;
+		FrameScheduler scheduler = clock.Scheduler(16ms);
+		scheduler.Request();
+		CHECK(scheduler.Tick());
+		clock.now += 5ms;
+		auto delay = scheduler.Request();
+		CHECK(delay && *delay == 11ms);
+		clock.now += 10ms;
+		CHECK(!scheduler.Tick());
+		CHECK(scheduler.Pending());
+		clock.now += 1ms;
+		CHECK(scheduler.Tick());
+		CHECK(scheduler.Stats().frames == 2);
+	}
+
+	void IdleSchedulerAsksForNoTimer() {
+		FakeClock clock;
+		FrameScheduler scheduler = clock.Scheduler(16ms);
+		CHECK(!scheduler.Pending());
+		clock.now += 1s;
+		CHECK(!scheduler.Tick());
+		scheduler.Request();
+		CHECK(scheduler.Pending());
+		CHECK(scheduler.Tick());
+		CHECK(!scheduler.Pending());
+		CHECK(scheduler.Stats().frames == 1);
+	}
+
+	void IdleTimeCountsOnlyStretchesWithoutAFrame() {
+		FakeClock clock;
+		FrameScheduler scheduler = clock.Scheduler(16ms);
+		clock.now += 100ms;
+		CHECK(scheduler.Stats().idle == 100ms);
+		scheduler.Request();
+		clock.now += 16ms;
+		CHECK(scheduler.Stats().idle == 100ms);
+		CHECK(scheduler.Tick());
+		clock.now += 30ms;
+		CHECK(scheduler.Stats().idle == 130ms);
+	}
+}
+
+int main() {
+	ManyRequestsBetweenTicksGiveOneFrame();
+	EarlyTickReturnsFalse();
+	IdleSchedulerAsksForNoTimer();
+	IdleTimeCountsOnlyStretchesWithoutAFrame();
+	return Failures();
+}
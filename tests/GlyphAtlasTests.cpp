@@ -0,0 +1,119 @@
+#include <cstdint>
+#include <string_view>
+#include <vector>
+#include "Check.h"
+#include "GlyphAtlas.h"
+#include "SoftwareRenderer.h"
+
+namespace {
+	constexpr int cellWidth = 3, cellHeight = 2;
+
+	// Every byte of a glyph's cell is derived from the glyph, so a cell that
+	// was overwritten or handed out for the wrong glyph shows.
+	void FakeRasterize(wchar_t glyph, std::uint8_t* coverage) {
+		for (int i = 0; i < cellWidth * cellHeight; ++i) {
+			coverage[i] = static_cast<std::uint8_t>(glyph * 7 + i);
+		}
+	}
+
+	bool CellHolds(GlyphAtlas const& atlas, GlyphAtlas::Location location, wchar_t glyph) {
+		std::uint8_t expected[cellWidth * cellHeight];
+		FakeRasterize(glyph, expected);
+		std::uint8_t const* cell = atlas.Cell(location);
+		return std::equal(cell, cell + cellWidth * cellHeight, expected);
+	}
+
+	// One page of 256 slots: the 257th glyph empties it, and the glyphs it
+	// held are rasterized again when they come back.
+	void FullPageIsEvicted() {
+		GlyphAtlas atlas{ cellWidth, cellHeight, FakeRasterize, 256, 1 };
+		for (wchar_t glyph = 0; glyph < 256; ++glyph) {
+			CHECK(CellHolds(atlas, atlas.Find(glyph), glyph));
+		}
+		for (wchar_t glyph = 0; glyph < 256; ++glyph) {
+			CHECK(CellHolds(atlas, atlas.Find(glyph), glyph));
+		}
+		GlyphAtlasStats stats = atlas.Stats();
+		CHECK(stats.misses == 256);
+		CHECK(stats.hits == 256);
+		CHECK(stats.evictions == 0);
+		CHECK(stats.pages == 1);
+
+		CHECK(CellHolds(atlas, atlas.Find(L'\x1000'), L'\x1000'));
+		CHECK(atlas.Stats().evictions == 1);
+		CHECK(atlas.Stats().misses == 257);
+		CHECK(CellHolds(atlas, atlas.Find(0), 0));
+		CHECK(atlas.Stats().misses == 258);
+		CHECK(CellHolds(atlas, atlas.Find(L'\x1000'), L'\x1000'));
+		CHECK(atlas.Stats().hits == 257);
+		CHECK(atlas.Stats().pages == 1);
+	}
+
+	// With two pages the one used least recently goes, whichever filled first.
+	void LeastRecentlyUsedPageIsEvicted() {
+		GlyphAtlas atlas{ cellWidth, cellHeight, FakeRasterize, 4, 2 };
+		for (wchar_t glyph : std::wstring_view{ L"abcdefgh" }) {
+			atlas.Find(glyph);
+		}
+		atlas.Find(L'a');
+		CHECK(atlas.Stats().misses == 8);
+		CHECK(CellHolds(atlas, atlas.Find(L'i'), L'i'));
+		CHECK(atlas.Stats().evictions == 1);
+		std::size_t misses = atlas.Stats().misses;
+		for (wchar_t glyph : std::wstring_view{ L"abcd" }) {
+			CHECK(CellHolds(atlas, atlas.Find(glyph), glyph));
+		}
+		CHECK(atlas.Stats().misses == misses);
+		CHECK(CellHolds(atlas, atlas.Find(L'e'), L'e'));
+		CHECK(atlas.Stats().misses == misses + 1);
+	}
+
+	// A text-heavy frame with more distinct glyphs than the renderer's atlas
+	// holds still blits every glyph's own pattern, frame after frame.
+	void TextHeavyFramesSurviveEviction() {
+		constexpr int columns = 40, rows = 30;
+		constexpr int width = columns * SoftwareRenderer::glyphAdvance, height = rows * SoftwareRenderer::lineHeight;
+		SoftwareRenderer renderer{ width, height };
+		Color background{ 1.f, 1.f, 1.f, 1.f };
+		auto glyphAt = [](int column, int row) { return static_cast<wchar_t>(0x4E00 + row * columns + column); };
+		auto paint = [&]() {
+			renderer.Clear(background);
+			for (int row = 0; row < rows; ++row) {
+				for (int column = 0; column < columns; ++column) {
+					float x = static_cast<float>(column * SoftwareRenderer::glyphAdvance), y = static_cast<float>(row * SoftwareRenderer::lineHeight);
+					wchar_t glyph = glyphAt(column, row);
+					renderer.DrawText({ x, y, x + SoftwareRenderer::glyphAdvance, y + SoftwareRenderer::lineHeight }, std::wstring_view{ &glyph, 1 }, Brush::TextWrite, {});
+				}
+			}
+			renderer.EndFrame();
+			return renderer.Target().pixels;
+		};
+
+		auto first = paint();
+		CHECK(renderer.Glyphs().evictions > 0);
+		std::uint32_t ink = PackColor(BrushColor(Brush::TextWrite)), paper = PackColor(background);
+		std::size_t wrong = 0;
+		for (int row = 0; row < rows; ++row) {
+			for (int column = 0; column < columns; ++column) {
+				std::uint64_t pattern = SoftwareRenderer::GlyphPattern(glyphAt(column, row));
+				for (int y = 0; y < SoftwareRenderer::lineHeight; ++y) {
+					for (int x = 0; x < SoftwareRenderer::glyphAdvance; ++x) {
+						int bit = (y - 4) * 5 + (x - 1);
+						bool inked = x >= 1 && x <= 5 && y >= 4 && bit < 64 && (pattern >> bit & 1);
+						std::size_t at = static_cast<std::size_t>(row * SoftwareRenderer::lineHeight + y) * width + column * SoftwareRenderer::glyphAdvance + x;
+						wrong += first[at] != (inked ? ink : paper);
+					}
+				}
+			}
+		}
+		CHECK(wrong == 0);
+		CHECK(paint() == first);
+	}
+}
+
+int main() {
+	FullPageIsEvicted();
+	LeastRecentlyUsedPageIsEvicted();
+	TextHeavyFramesSurviveEviction();
+	return Failures();
+}
@@ -0,0 +1,39 @@
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <new>
+#include <string_view>
+#include "FrameHarness.h"
+
+// Counts every heap allocation for the harness's allocation budgets.
+void* operator new(std::size_t size) {
+	allocationCount.fetch_add(1, std::memory_order_relaxed);
+	if (void* p = std::malloc(size ? size : 1)) {
+		return p;
+	}
+	throw std::bad_alloc{};
+}
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+// "GoldenFrames <dir>" checks the standard frames against the images in
+// <dir>; "--budgets" also checks them against its time and allocation
+// budgets, and "--record" writes images and budgets instead. The exit code
+// is the number of failed frames.
+int main(int argc, char** argv) {
+	if (argc < 2) {
+		std::cerr << "usage: GoldenFrames <dir> [--budgets | --record]\n";
+		return 1;
+	}
+	allocationsCounted = true;
+	std::filesystem::path directory{ argv[1] };
+	std::string_view flag{ argc > 2 ? argv[2] : "" };
+	auto mode = flag == "--record" ? GoldenMode::Record : flag == "--budgets" ? GoldenMode::Budgets : GoldenMode::Check;
+	auto failures = RunGoldenFrames(directory, mode);
+	std::cout << std::ifstream{ directory / "report.txt" }.rdbuf();
+	return static_cast<int>(failures);
+}
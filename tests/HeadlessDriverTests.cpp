@@ -0,0 +1,91 @@
+#include <chrono>
+#include <cstdio>
+#include <sstream>
+#include <string>
+#include "Check.h"
+#include "HeadlessDriver.h"
+
+namespace {
+	Point Center(ControlHandle handle) {
+		Rect area = ControlContainer::GetInstance().Get<Control>(handle)->Area();
+		return { (area.left + area.right) / 2.f, (area.top + area.bottom) / 2.f };
+	}
+
+	void TypingReachesTheControlsAndThePixels() {
+		Application application;
+		HeadlessDriver driver{ application, 400, 500 };
+		auto const& ui = application.Handles();
+		auto blank = driver.Target().pixels;
+		std::size_t framesBefore = driver.Stats().frames;
+
+		driver.Send(InputEvent::PointerDown(Center(ui.input)));
+		driver.Send(InputEvent::PointerUp(Center(ui.input)));
+		for (wchar_t ch : std::wstring_view{ L"abc" }) {
+			CHECK(driver.Send(InputEvent::Char(ch)) > std::chrono::steady_clock::duration::zero());
+		}
+
+		auto input = ControlContainer::GetInstance().Get<TextBox>(ui.input);
+		CHECK(input && input->Text() == L"abc");
+		CHECK(driver.Stats().events == 5);
+		CHECK(driver.Stats().frames > framesBefore);
+		CHECK(driver.Target().pixels != blank);
+	}
+
+	// A keystroke that changes nothing is presented as soon as it is handled;
+	// one that changes the input waits for the frame that paints it.
+	void KeystrokesArePresentedOnceShown() {
+		Application application;
+		HeadlessDriver driver{ application, 400, 500 };
+		auto const& ui = application.Handles();
+		driver.Send(InputEvent::PointerDown(Center(ui.input)));
+		driver.Send(InputEvent::PointerUp(Center(ui.input)));
+		auto& latency = InputLatency::GetInstance();
+		latency.Reset();
+		auto presented = [&]() { return latency.Stage(LatencyStage::Present).Count(); };
+
+		driver.Post(InputEvent::Key(keyBack));
+		application.Pump();
+		CHECK(presented() == 1);
+		CHECK(!driver.Frame());
+		CHECK(presented() == 1);
+
+		driver.Post(InputEvent::Char(L'a'));
+		application.Pump();
+		CHECK(presented() == 1);
+		CHECK(driver.Frame());
+		CHECK(presented() == 2);
+		CHECK(latency.Stage(LatencyStage::Total).Count() == 2);
+		CHECK(!driver.Frame());
+		CHECK(presented() == 2);
+	}
+
+	// Every run in the report delivers the whole scripted session, paints
+	// frames and measures a latency for it.
+	void BenchmarkDeliversEventsAndPaintsFrames() {
+		std::istringstream report{ RunInputBenchmark(2) };
+		std::string line;
+		int runs = 0, latencies = 0;
+		while (std::getline(report, line)) {
+			std::size_t events = 0, frames = 0;
+			if (std::sscanf(line.c_str(), "events %zu, frames %zu", &events, &frames) == 2) {
+				++runs;
+				CHECK(events > 100);
+				CHECK(frames > 0);
+				CHECK(frames <= events + 1);
+			}
+			if (line.starts_with("latency p50 ")) {
+				++latencies;
+				CHECK(line.find("max 0 us") == std::string::npos);
+			}
+		}
+		CHECK(runs > 0);
+		CHECK(latencies == runs);
+	}
+}
+
+int main() {
+	TypingReachesTheControlsAndThePixels();
+	KeystrokesArePresentedOnceShown();
+	BenchmarkDeliversEventsAndPaintsFrames();
+	return Failures();
+}
@@ -0,0 +1,120 @@
+#include <chrono>
+#include <vector>
+#include "Check.h"
+#include "InputBatcher.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+	InputEvent MoveAt(Point point, std::chrono::steady_clock::time_point time) {
+		InputEvent event = InputEvent::PointerMove(point);
+		event.time = time;
+		return event;
+	}
+
+	bool SamePoint(Point a, Point b) {
+		return a.x == b.x && a.y == b.y;
+	}
+
+	std::vector<InputEvent> Drained(InputBatcher& batcher) {
+		std::vector<InputEvent> events;
+		batcher.Drain([&](InputEvent const& event) { events.push_back(event); });
+		return events;
+	}
+
+	void ConsecutiveMovesCollapseToTheLatestPosition() {
+		InputBatcher batcher;
+		auto first = std::chrono::steady_clock::time_point{} + 1s;
+		batcher.Push(MoveAt({ 1.f, 1.f }, first));
+		batcher.Push(MoveAt({ 2.f, 3.f }, first + 4ms));
+		batcher.Push(MoveAt({ 5.f, 8.f }, first + 8ms));
+		auto events = Drained(batcher);
+		CHECK(events.size() == 1);
+		CHECK(events[0].kind == InputEvent::Kind::PointerMove);
+		CHECK(SamePoint(events[0].point, { 5.f, 8.f }));
+		CHECK(events[0].time == first);
+		CHECK(batcher.Stats().received == 3);
+		CHECK(batcher.Stats().delivered == 1);
+		CHECK(batcher.Stats().coalesced == 2);
+		CHECK(batcher.Empty());
+	}
+
+	void OtherEventsKeepTheirOrderAndSplitMoves() {
+		InputBatcher batcher;
+		batcher.Push(InputEvent::PointerMove({ 1.f, 1.f }));
+		batcher.Push(InputEvent::PointerMove({ 2.f, 2.f }));
+		batcher.Push(InputEvent::PointerDown({ 2.f, 2.f }));
+		batcher.Push(InputEvent::Char(L'a'));
+		batcher.Push(InputEvent::PointerMove({ 3.f, 3.f }));
+		batcher.Push(InputEvent::PointerMove({ 4.f, 4.f }));
+		batcher.Push(InputEvent::Key(13));
+		batcher.Push(InputEvent::PointerUp({ 4.f, 4.f }));
+		auto events = Drained(batcher);
+		using Kind = InputEvent::Kind;
+		std::vector<Kind> expected{ Kind::PointerMove, Kind::PointerDown, Kind::Char, Kind::PointerMove, Kind::Key, Kind::PointerUp };
+		CHECK(events.size() == expected.size());
+		for (std::size_t i = 0; i < events.size() && i < expected.size(); ++i) {
+			CHECK(events[i].kind == expected[i]);
+		}
+		if (events.size() == expected.size()) {
+			CHECK(SamePoint(events[0].point, { 2.f, 2.f }));
+			CHECK(events[2].ch == L'a');
+			CHECK(SamePoint(events[3].point, { 4.f, 4.f }));
+			CHECK(events[4].key == 13);
+		}
+		CHECK(batcher.Stats().coalesced == 2);
+	}
+
+	void HistoryHoldsEveryPositionUntilDrain() {
+		InputBatcher batcher;
+		batcher.KeepHistory(true);
+		std::vector<Point> positions{ { 1.f, 1.f }, { 2.f, 2.f }, { 3.f, 3.f } };
+		for (Point point : positions) {
+			batcher.Push(InputEvent::PointerMove(point));
+		}
+		batcher.Push(InputEvent::Char(L'x'));
+		CHECK(batcher.History().size() == positions.size());
+		std::size_t seenDuringDrain = 0;
+		batcher.Drain([&](InputEvent const&) { seenDuringDrain = batcher.History().size(); });
+		CHECK(seenDuringDrain == positions.size());
+		CHECK(batcher.History().empty());
+		for (std::size_t i = 0; i < positions.size(); ++i) {
+			batcher.Push(InputEvent::PointerMove(positions[i]));
+		}
+		auto history = batcher.History();
+		CHECK(history.size() == positions.size());
+		for (std::size_t i = 0; i < history.size() && i < positions.size(); ++i) {
+			CHECK(SamePoint(history[i], positions[i]));
+		}
+	}
+
+	void HistoryCanBeResetWhileDraining() {
+		InputBatcher batcher;
+		batcher.KeepHistory(true);
+		batcher.Push(InputEvent::PointerMove({ 1.f, 1.f }));
+		batcher.Push(InputEvent::PointerMove({ 2.f, 2.f }));
+		batcher.Push(InputEvent::Char(L'x'));
+		// A control that stops and restarts tracing mid-drain, then sees a
+		// move arrive before the drain is over.
+		batcher.Drain([&](InputEvent const& event) {
+			if (event.kind == InputEvent::Kind::Char) {
+				batcher.KeepHistory(false);
+				batcher.KeepHistory(true);
+				batcher.Push(InputEvent::PointerMove({ 5.f, 5.f }));
+			}
+		});
+		auto history = batcher.History();
+		CHECK(history.size() == 1);
+		CHECK(!history.empty() && SamePoint(history[0], { 5.f, 5.f }));
+		CHECK(Drained(batcher).size() == 1);
+		CHECK(batcher.History().empty());
+	}
+}
+
+int main() {
+	ConsecutiveMovesCollapseToTheLatestPosition();
+	OtherEventsKeepTheirOrderAndSplitMoves();
+	HistoryHoldsEveryPositionUntilDrain();
+	HistoryCanBeResetWhileDraining();
+	return Failures();
+}
@@ -0,0 +1,85 @@
+#include <chrono>
+#include <stdexcept>
+#include <vector>
+#include "Check.h"
+#include "InputRecording.h"
+
+using namespace std::chrono_literals;
+
+namespace {
+	std::vector<InputEvent> Session() {
+		auto time = std::chrono::steady_clock::now();
+		std::vector<InputEvent> events{
+			InputEvent::Resize({ 400.f, 500.f }),
+			InputEvent::PointerMove({ 12.f, -3.f }),
+			InputEvent::PointerDown({ 200.f, 40.f }),
+			InputEvent::PointerUp({ 200.f, 40.f }),
+			InputEvent::Char(L'\x4E2D'),
+			InputEvent::Key(0x25),
+			InputEvent::Wheel({ 100.f, 300.f }, -360),
+		};
+		for (auto& event : events) {
+			event.time = time;
+			time += 1500us;
+		}
+		return events;
+	}
+
+	void RecordingRoundTrips() {
+		InputRecorder recorder;
+		auto events = Session();
+		for (auto const& event : events) {
+			recorder.Record(event);
+		}
+		auto session = ParseInput(recorder.Bytes());
+		CHECK(session.size() == events.size());
+		for (std::size_t i = 1; i < session.size() && i < events.size(); ++i) {
+			InputEvent const& a = session[i].event;
+			InputEvent const& b = events[i];
+			CHECK(session[i].delay == 1500us);
+			CHECK(a.kind == b.kind);
+			CHECK(a.point.x == b.point.x && a.point.y == b.point.y);
+			CHECK(a.delta == b.delta);
+			CHECK(a.key == b.key);
+			CHECK(a.ch == b.ch);
+		}
+		CHECK(!session.empty() && session[0].event.size.width == 400.f && session[0].event.size.height == 500.f);
+	}
+
+	void MalformedRecordingsThrow() {
+		auto throws = [](std::vector<std::uint8_t> const& bytes) {
+			try {
+				ParseInput(bytes);
+			} catch (std::runtime_error const&) {
+				return true;
+			}
+			return false;
+		};
+		InputRecorder recorder;
+		recorder.Record(InputEvent::PointerMove({ 1.f, 2.f }));
+		auto bytes = recorder.Bytes();
+		CHECK(throws({ 'R', 'V' }));
+		auto wrongVersion = bytes;
+		wrongVersion[4] = 99;
+		CHECK(throws(wrongVersion));
+		auto truncated = bytes;
+		truncated.back() |= 0x80;
+		CHECK(throws(truncated));
+	}
+
+	void ReplayDrivesTheApplication() {
+		InputRecorder recorder;
+		for (auto const& event : Session()) {
+			recorder.Record(event);
+		}
+		std::string report = ReplayInput(ParseInput(recorder.Bytes()), ReplaySpeed::Maximum);
+		CHECK(report.starts_with("events 7,"));
+	}
+}
+
+int main() {
+	RecordingRoundTrips();
+	MalformedRecordingsThrow();
+	ReplayDrivesTheApplication();
+	return Failures();
+}
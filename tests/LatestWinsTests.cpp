@@ -0,0 +1,156 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Check.h"
+#include "Controls.h"
+#include "Executor.h"
+
+namespace {
+	constexpr std::size_t edits = 8;
+
+	std::size_t TextLength(ControlHandle handle) {
+		return ControlContainer::GetInstance().Get<TextBox>(handle)->Text().size();
+	}
+
+	// Runs every result posted so far until count have been.
+	void DrainUntil(std::size_t count) {
+		std::size_t drained = 0;
+		while (drained < count) {
+			drained += UiQueue::GetInstance().Drain();
+		}
+	}
+
+	// Fires edits into a text box whose change handler runs on an executor,
+	// holding each edit's work until every newer one has finished, so results
+	// reach the UI thread newest first. Only the newest may be applied.
+	void OnlyTheLatestEditIsApplied() {
+		Executor executor{ edits };
+		auto& controls = ControlContainer::GetInstance();
+		controls.SetBackgroundExecutor(&executor);
+
+		std::mutex mutex;
+		std::condition_variable finished;
+		std::size_t done = 0;
+		std::vector<std::size_t> applied;
+
+		auto box = new TextBox{ { 0.f, 0.f, 100.f, 20.f } };
+		ControlHandle handle = box->Handle();
+		box->WhenChangeAsync(
+			[handle]() { return TextLength(handle); },
+			[&](std::size_t length, CancellationToken const&) {
+				std::unique_lock lock{ mutex };
+				finished.wait(lock, [&]() { return done == edits - length; });
+				++done;
+				finished.notify_all();
+				return length;
+			},
+			[&](std::size_t length) { applied.push_back(length); });
+
+		for (std::size_t i = 0; i < edits; ++i) {
+			box->OnChar(L'a');
+		}
+		{
+			std::unique_lock lock{ mutex };
+			finished.wait(lock, [&]() { return done == edits; });
+		}
+		// The workers post before they go idle; wait for every result to land.
+		DrainUntil(edits);
+
+		CHECK(applied.size() == 1);
+		CHECK(!applied.empty() && applied.back() == edits);
+		controls.Remove(handle);
+		controls.SetBackgroundExecutor(nullptr);
+	}
+
+	// Each edit's work runs until its token is cancelled or the test lets it
+	// finish. Every superseded edit must see its token cancelled and stop
+	// early; only the newest runs to the end and is applied.
+	void SupersededWorkIsCancelled() {
+		Executor executor{ 2 };
+		auto& controls = ControlContainer::GetInstance();
+		controls.SetBackgroundExecutor(&executor);
+
+		std::mutex mutex;
+		std::vector<CancellationToken> tokens(edits + 1);
+		std::vector<bool> stoppedEarly(edits + 1, false);
+		std::atomic<bool> release{ false };
+		std::vector<std::size_t> applied;
+
+		auto box = new TextBox{ { 0.f, 0.f, 100.f, 20.f } };
+		ControlHandle handle = box->Handle();
+		box->WhenChangeAsync(
+			[handle]() { return TextLength(handle); },
+			[&](std::size_t length, CancellationToken const& token) {
+				{
+					std::lock_guard lock{ mutex };
+					tokens[length] = token;
+				}
+				while (!token.Cancelled() && !release.load()) {
+					std::this_thread::sleep_for(std::chrono::microseconds{ 100 });
+				}
+				std::lock_guard lock{ mutex };
+				stoppedEarly[length] = token.Cancelled();
+				return length;
+			},
+			[&](std::size_t length) { applied.push_back(length); });
+
+		for (std::size_t i = 0; i < edits; ++i) {
+			box->OnChar(L'a');
+		}
+		// The superseded edits stop without being released.
+		DrainUntil(edits - 1);
+		CHECK(applied.empty());
+		release = true;
+		DrainUntil(1);
+
+		std::lock_guard lock{ mutex };
+		for (std::size_t length = 1; length < edits; ++length) {
+			CHECK(tokens[length].Cancelled());
+			CHECK(stoppedEarly[length]);
+		}
+		CHECK(!tokens[edits].Cancelled());
+		CHECK(!stoppedEarly[edits]);
+		CHECK(applied.size() == 1 && applied.back() == edits);
+		controls.Remove(handle);
+		controls.SetBackgroundExecutor(nullptr);
+	}
+
+	// Without an executor the work and apply run inside the change, which
+	// keeps headless runs such as the golden frames deterministic.
+	void WithoutAnExecutorWorkRunsInline() {
+		auto& controls = ControlContainer::GetInstance();
+		CHECK(controls.BackgroundExecutor() == nullptr);
+		std::vector<std::size_t> applied;
+		std::thread::id workedOn;
+
+		auto box = new TextBox{ { 0.f, 0.f, 100.f, 20.f } };
+		ControlHandle handle = box->Handle();
+		box->WhenChangeAsync(
+			[handle]() { return TextLength(handle); },
+			[&](std::size_t length, CancellationToken const& token) {
+				workedOn = std::this_thread::get_id();
+				CHECK(!token.Cancelled());
+				return length;
+			},
+			[&](std::size_t length) { applied.push_back(length); });
+
+		for (std::size_t i = 1; i <= 3; ++i) {
+			box->OnChar(L'a');
+			CHECK(applied.size() == i && applied.back() == i);
+		}
+		CHECK(workedOn == std::this_thread::get_id());
+		CHECK(UiQueue::GetInstance().Drain() == 0);
+		controls.Remove(handle);
+	}
+}
+
+int main() {
+	OnlyTheLatestEditIsApplied();
+	SupersededWorkIsCancelled();
+	WithoutAnExecutorWorkRunsInline();
+	return Failures();
+}
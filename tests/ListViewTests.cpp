@@ -0,0 +1,137 @@
+#include <cstddef>
+#include <random>
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "Controls.h"
+#include "FenwickTree.h"
+
+namespace {
+	// Checks Prefix and Find against plain sums after every Set and PushBack.
+	void FenwickTreeMatchesPlainSums() {
+		std::mt19937 random{ 7 };
+		FenwickTree<int> tree;
+		std::vector<int> values;
+		tree.Assign(5, 3);
+		values.assign(5, 3);
+		for (int step = 0; step < 400; ++step) {
+			if (random() % 3 == 0) {
+				int value = static_cast<int>(random() % 6);
+				tree.PushBack(value);
+				values.push_back(value);
+			}
+			else {
+				std::size_t index = random() % values.size();
+				int value = static_cast<int>(random() % 6);
+				tree.Set(index, value);
+				values[index] = value;
+			}
+			CHECK(tree.Size() == values.size());
+			std::vector<int> prefix{ 0 };
+			for (int value : values) {
+				prefix.push_back(prefix.back() + value);
+			}
+			for (std::size_t count = 0; count <= values.size(); ++count) {
+				CHECK(tree.Prefix(count) == prefix[count]);
+			}
+			CHECK(tree.Total() == prefix.back());
+			for (int offset = 0; offset <= prefix.back() + 1; ++offset) {
+				std::size_t expected = 0;
+				for (std::size_t i = 0; i < prefix.size(); ++i) {
+					if (prefix[i] <= offset) {
+						expected = i;
+					}
+				}
+				CHECK(tree.Find(offset) == expected);
+			}
+		}
+	}
+
+	struct CountingList {
+		ListView* view;
+		std::size_t requests{ 0 };
+
+		explicit CountingList(std::size_t count, Rect area = { 0.f, 0.f, 200.f, 200.f })
+			: view{ new ListView{ area } } {
+			view->SetItems(count, [this](std::size_t index) {
+				++requests;
+				return std::to_wstring(index);
+			});
+		}
+
+		~CountingList() {
+			ControlContainer::GetInstance().Remove(view->Handle());
+		}
+
+		// The rows drawn by one paint, top to bottom.
+		std::vector<std::wstring> Paint() {
+			DisplayList list;
+			view->Record(list);
+			std::vector<std::wstring> rows;
+			for (auto const& command : list.Commands()) {
+				if (command.kind == DrawCommand::Kind::DrawText) {
+					rows.emplace_back(list.Text(command));
+				}
+			}
+			return rows;
+		}
+	};
+
+	// Scrolling a 1M-item list only asks the source for rows that scroll
+	// into view, and every frame shows the rows at its offset.
+	void MillionItemScrollRecyclesRows() {
+		constexpr std::size_t items = 1'000'000;
+		CountingList list{ items };
+		auto rows = list.Paint();
+		CHECK(rows.size() == 10);
+		CHECK(!rows.empty() && rows.front() == L"0");
+		std::size_t requests = list.requests;
+		CHECK(requests == rows.size());
+		list.Paint();
+		CHECK(list.requests == requests);
+
+		for (std::size_t step = 0; step < 1000; ++step) {
+			list.view->OnWheel(-120);
+			requests = list.requests;
+			rows = list.Paint();
+			// Three rows scroll in per notch.
+			CHECK(list.requests - requests <= 4);
+		}
+		CHECK(!rows.empty() && rows.front() == L"3000");
+
+		list.view->ScrollToItem(654'321);
+		rows = list.Paint();
+		CHECK(!rows.empty() && rows.front() == L"654321");
+		list.view->ScrollTo(1e12f);
+		rows = list.Paint();
+		CHECK(!rows.empty() && rows.back() == std::to_wstring(items - 1));
+		requests = list.requests;
+		list.Paint();
+		CHECK(list.requests == requests);
+	}
+
+	// Rows made shorter than the default fit more per viewport than the pool
+	// was first sized for; a repaint must still not ask the source again.
+	void ShorterRowsGrowThePool() {
+		CountingList list{ 1000 };
+		list.Paint();
+		for (std::size_t i = 0; i < 100; ++i) {
+			list.view->SetRowHeight(i, 4.f);
+		}
+		auto rows = list.Paint();
+		CHECK(rows.size() == 50);
+		std::size_t requests = list.requests;
+		list.Paint();
+		CHECK(list.requests == requests);
+		for (std::size_t i = 0; i < rows.size(); ++i) {
+			CHECK(rows[i] == std::to_wstring(i));
+		}
+	}
+}
+
+int main() {
+	FenwickTreeMatchesPlainSums();
+	MillionItemScrollRecyclesRows();
+	ShorterRowsGrowThePool();
+	return Failures();
+}
@@ -0,0 +1,103 @@
+#include <string>
+#include <vector>
+#include "Check.h"
+#include "Controls.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+
+namespace {
+	// What a control recorded, copied out so a later pass cannot change it.
+	struct Recorded {
+		std::vector<DrawCommand> commands;
+		std::vector<std::wstring> texts;
+	};
+
+	bool SameCommand(DrawCommand const& a, DrawCommand const& b) {
+		return a.kind == b.kind && a.brush == b.brush && a.rect == b.rect && a.color == b.color
+			&& a.textKey.owner == b.textKey.owner && a.textKey.item == b.textKey.item
+			&& a.textKey.version == b.textKey.version;
+	}
+
+	// Invalidates every control, paints them all and returns what each recorded.
+	std::vector<Recorded> PaintAll(std::vector<Control*> const& spawned, SoftwareRenderer& renderer, Rect region) {
+		auto& controls = ControlContainer::GetInstance();
+		for (auto control : spawned) {
+			control->Invalidate();
+		}
+		controls.TakeDirty();
+		controls.Paint(renderer, region);
+		renderer.EndFrame();
+
+		std::vector<Recorded> recorded;
+		for (auto control : spawned) {
+			auto const& list = control->Display();
+			Recorded copy;
+			for (auto const& command : list.Commands()) {
+				copy.commands.push_back(command);
+				copy.texts.emplace_back(list.Text(command));
+			}
+			recorded.push_back(std::move(copy));
+		}
+		return recorded;
+	}
+
+	void ParallelRecordingMatchesSerial() {
+		auto& controls = ControlContainer::GetInstance();
+		Rect region{ 0.f, 0.f, 400.f, 300.f };
+		std::vector<Control*> spawned;
+		for (int i = 0; i < 120; ++i) {
+			float x = static_cast<float>(i % 10) * 40.f, y = static_cast<float>(i / 10) * 24.f;
+			Rect area{ x, y, x + 36.f, y + 20.f };
+			switch (i % 4) {
+			case 0: spawned.push_back(new Label{ area, std::to_wstring(i) }); break;
+			case 1: {
+				auto box = new TextBox{ area };
+				box->OnChar(static_cast<wchar_t>(L'a' + i % 26));
+				spawned.push_back(box);
+				break;
+			}
+			case 2: spawned.push_back(new Button{ area }); break;
+			default: {
+				auto list = new ListView{ area };
+				list->SetItems(static_cast<std::size_t>(i), [](std::size_t index) { return std::to_wstring(index); });
+				spawned.push_back(list);
+				break;
+			}
+			}
+		}
+
+		SoftwareRenderer serialTarget{ 400, 300 };
+		controls.SetRecordPool(nullptr);
+		auto serial = PaintAll(spawned, serialTarget, region);
+		CHECK(!controls.LastPaint().parallel);
+		CHECK(controls.LastPaint().recorded == spawned.size());
+
+		ThreadPool pool{ 4 };
+		SoftwareRenderer parallelTarget{ 400, 300 };
+		controls.SetRecordPool(&pool);
+		auto parallel = PaintAll(spawned, parallelTarget, region);
+		CHECK(controls.LastPaint().parallel);
+		CHECK(controls.LastPaint().recorded == spawned.size());
+		controls.SetRecordPool(nullptr);
+
+		CHECK(serialTarget.Target().pixels == parallelTarget.Target().pixels);
+		CHECK(serial.size() == parallel.size());
+		for (std::size_t i = 0; i < serial.size() && i < parallel.size(); ++i) {
+			auto const& a = serial[i];
+			auto const& b = parallel[i];
+			CHECK(a.commands.size() == b.commands.size() && a.texts == b.texts);
+			for (std::size_t c = 0; c < a.commands.size() && c < b.commands.size(); ++c) {
+				CHECK(SameCommand(a.commands[c], b.commands[c]));
+			}
+		}
+
+		for (auto control : spawned) {
+			controls.Remove(control->Handle());
+		}
+	}
+}
+
+int main() {
+	ParallelRecordingMatchesSerial();
+	return Failures();
+}
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Controls.h"
+#include "SoftwareRenderer.h"
+#include "ThreadPool.h"
+
+// Rebuilds every display list of a few thousand controls while painting them
+// into a software target, once per thread count, so the timings show how
+// recording scales. Usage: RecordingBenchmark [passes]
+int main(int argc, char** argv) {
+	constexpr int controlCount = 5000;
+	int passes = argc > 1 ? (std::max)(std::atoi(argv[1]), 1) : 10;
+	auto& controls = ControlContainer::GetInstance();
+
+	std::vector<Control*> spawned;
+	spawned.reserve(controlCount);
+	for (int i = 0; i < controlCount; ++i) {
+		float x = static_cast<float>(i % 100) * 10.f, y = static_cast<float>(i / 100) * 10.f;
+		Rect area{ x, y, x + 8.f, y + 8.f };
+		switch (i % 3) {
+		case 0: spawned.emplace_back(new Label{ area, std::to_wstring(i) }); break;
+		case 1: spawned.emplace_back(new TextBox{ area }); break;
+		default: spawned.emplace_back(new Button{ area }); break;
+		}
+	}
+
+	SoftwareRenderer target{ 1000, 500 };
+	Rect region{ 0.f, 0.f, 1000.f, 500.f };
+	std::printf("Controls: %zu\n", controls.Size());
+	std::size_t counts[]{ 1, 2, 4, (std::max)(std::thread::hardware_concurrency(), 1u) };
+	for (auto threads : counts) {
+		ThreadPool pool{ threads };
+		controls.SetRecordPool(&pool);
+		std::chrono::steady_clock::duration total{};
+		for (int i = 0; i < passes; ++i) {
+			for (auto control : spawned) {
+				control->Invalidate();
+			}
+			controls.TakeDirty();
+			auto start = std::chrono::steady_clock::now();
+			controls.Paint(target, region);
+			total += std::chrono::steady_clock::now() - start;
+			target.EndFrame();
+		}
+		std::printf("%zu threads: %lld us, %u recorded\n", threads,
+			static_cast<long long>(std::chrono::duration_cast<std::chrono::microseconds>(total).count() / passes),
+			controls.LastPaint().recorded);
+	}
+	controls.SetRecordPool(nullptr);
+
+	for (auto control : spawned) {
+		controls.Remove(control->Handle());
+	}
+	return 0;
+}